@@ -0,0 +1,207 @@
+/* ************************************************************
+ * Offline batch analysis: range splitting, worker pool and merge
+ * ************************************************************/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include "batch.h"
+#include "../capture/capture.h"
+
+_Static_assert(sizeof(batchResult) == 24, "batch results are 24 bytes");
+
+typedef struct {
+    const batchAnalyzer *a;
+    const uint8_t *data;        /* First sample (mapped file) */
+    int channels;
+    int N;
+    uint64_t nblocks;
+    int nranges;
+    batchResult *results;       /* One per block, in block order */
+    atomic_int nextRange;
+    atomic_int failed;
+} batchShared;
+
+typedef struct {
+    batchShared *run;
+    pthread_t thread;
+    double cpuSec;
+} batchWorker;
+
+/* Block b (from 0) as the capture device delivers it: first channel,
+ * unsigned 16-bit */
+static void blockU16(const batchShared *run, uint64_t b, uint16_t *x) {
+    const size_t frame = 2 * (size_t)run->channels;
+    const uint8_t *p = run->data + b * run->N * frame;
+
+    for (int i = 0; i < run->N; i++, p += frame) {
+        x[i] = (uint16_t)(p[0] | (p[1] << 8)) ^ 0x8000;
+    }
+}
+
+static void *batchWorkerThread(void *arg) {
+    batchWorker *w = arg;
+    batchShared *run = w->run;
+    const batchAnalyzer *a = run->a;
+    const uint64_t warmup = (a->warmupBlocks > BATCH_WARMUP_BLOCKS) ? a->warmupBlocks : BATCH_WARMUP_BLOCKS;
+    void *state = NULL;
+    uint16_t *x = malloc(run->N * sizeof(uint16_t));
+    struct timespec cpu;
+
+    if (x == NULL || posix_memalign(&state, 64, a->stateSize) != 0) {
+        state = NULL;
+        atomic_store(&run->failed, 1);
+    } else {
+        memset(state, 0, a->stateSize);
+        if (a->init(state) != 0) atomic_store(&run->failed, 1);
+    }
+
+    int r;
+    while (!atomic_load(&run->failed) && (r = atomic_fetch_add(&run->nextRange, 1)) < run->nranges) {
+        uint64_t first = (uint64_t)r * BATCH_RANGE_BLOCKS;
+        uint64_t end = first + BATCH_RANGE_BLOCKS;
+        uint64_t b = (first > warmup) ? first - warmup : 0;
+        batchResult warm;
+
+        if (end > run->nblocks) end = run->nblocks;
+        a->reset(state);
+        for (; b < end; b++) {
+            batchResult *res = (b >= first) ? &run->results[b] : &warm;
+            blockU16(run, b, x);
+            memset(res, 0, sizeof(*res));
+            a->block(state, x, res);
+            res->block = (uint32_t)(b + 1);
+        }
+    }
+
+    if (state != NULL && a->destroy != NULL) a->destroy(state);
+    free(state);
+    free(x);
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu);
+    w->cpuSec = cpu.tv_sec + cpu.tv_nsec / 1e9;
+    return NULL;
+}
+
+static int writeResults(const char *path, int fs, int N, const batchResult *results, uint64_t nblocks) {
+    struct {
+        char magic[8];
+        uint32_t version;
+        uint32_t recordSize;
+        uint32_t fs;
+        uint32_t N;
+        uint64_t blocks;
+    } header = { "RTBATCH", BATCH_VERSION, sizeof(batchResult), fs, N, nblocks };
+
+    FILE *f = fopen(path, "wb");
+    if (f == NULL) {
+        perror(path);
+        return -1;
+    }
+    if (fwrite(&header, sizeof(header), 1, f) != 1
+        || fwrite(results, sizeof(batchResult), nblocks, f) != nblocks) {
+        perror(path);
+        fclose(f);
+        return -1;
+    }
+    return fclose(f);
+}
+
+int batchRun(const char *wavPath, const char *outPath, int fs, int N, int jobs,
+             const batchAnalyzer *a, batchReport *rep) {
+    captureWavLayout layout;
+    batchWorker workers[BATCH_MAX_JOBS];
+    batchShared run;
+    struct timespec t0, t1;
+    int ret = -1;
+
+    memset(rep, 0, sizeof(*rep));
+    if (jobs <= 0) jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (jobs < 1) jobs = 1;
+    if (jobs > BATCH_MAX_JOBS) jobs = BATCH_MAX_JOBS;
+
+    FILE *f = fopen(wavPath, "rb");
+    if (f == NULL) {
+        perror(wavPath);
+        return -1;
+    }
+    if (captureWavParse(f, wavPath, fs, &layout) != 0) {
+        fclose(f);
+        return -1;
+    }
+
+    /* Mapped: the workers read their ranges from the page cache, no copy */
+    size_t mapSize = layout.dataStart + layout.dataSize;
+    uint8_t *map = mmap(NULL, mapSize, PROT_READ, MAP_PRIVATE, fileno(f), 0);
+    fclose(f);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "%s: cannot map the file [%s]\n", wavPath, strerror(errno));
+        return -1;
+    }
+    madvise(map, mapSize, MADV_SEQUENTIAL);
+
+    memset(&run, 0, sizeof(run));
+    run.a = a;
+    run.data = map + layout.dataStart;
+    run.channels = layout.channels;
+    run.N = N;
+    run.nblocks = layout.dataSize / (2 * (uint64_t)layout.channels) / N;  /* Complete blocks */
+    run.nranges = (int)((run.nblocks + BATCH_RANGE_BLOCKS - 1) / BATCH_RANGE_BLOCKS);
+    atomic_init(&run.nextRange, 0);
+    atomic_init(&run.failed, 0);
+    run.results = calloc(run.nblocks > 0 ? run.nblocks : 1, sizeof(batchResult));
+    if (run.results == NULL) {
+        fprintf(stderr, "%s: no memory for the results of %llu blocks\n", wavPath,
+                (unsigned long long)run.nblocks);
+        munmap(map, mapSize);
+        return -1;
+    }
+    if (jobs > run.nranges && run.nranges > 0) jobs = run.nranges;
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    int started = 0;
+    for (; started < jobs; started++) {
+        workers[started].run = &run;
+        workers[started].cpuSec = 0.0;
+        int err = pthread_create(&workers[started].thread, NULL, batchWorkerThread, &workers[started]);
+        if (err != 0) {
+            fprintf(stderr, "Batch: cannot create worker %d [%s]\n", started, strerror(err));
+            break;  /* The others take all the ranges */
+        }
+    }
+    for (int i = 0; i < started; i++) {
+        pthread_join(workers[i].thread, NULL);
+        rep->cpuSec += workers[i].cpuSec;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    if (started == 0 || atomic_load(&run.failed)) {
+        fprintf(stderr, "Batch: analysis failed\n");
+    } else if (writeResults(outPath, fs, N, run.results, run.nblocks) == 0) {
+        rep->blocks = run.nblocks;
+        rep->jobs = started;
+        rep->ranges = run.nranges;
+        rep->audioSec = (double)run.nblocks * N / fs;
+        rep->wallSec = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+        ret = 0;
+    }
+
+    free(run.results);
+    munmap(map, mapSize);
+    return ret;
+}
+
+void batchPrintReport(FILE *f, const batchReport *rep) {
+    fprintf(f, "Batch: %llu blocks (%.1f s of audio) in %d ranges, %d workers\n",
+            (unsigned long long)rep->blocks, rep->audioSec, rep->ranges, rep->jobs);
+    fprintf(f, "   %.3f s wall, %.3f s CPU: %.1f audio-s per wall-s (%.1f per CPU-s)\n",
+            rep->wallSec, rep->cpuSec,
+            rep->wallSec > 0.0 ? rep->audioSec / rep->wallSec : 0.0,
+            rep->cpuSec > 0.0 ? rep->audioSec / rep->cpuSec : 0.0);
+}
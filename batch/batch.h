@@ -0,0 +1,91 @@
+/* ************************************************************
+ * Offline batch analysis of a recording
+ *
+ * The samples of a WAV file (mapped, not read) are cut in blocks of N
+ * samples, numbered 1, 2, ... as the captured blocks (seq), and the
+ * blocks in ranges of BATCH_RANGE_BLOCKS. A pool of worker threads
+ * takes the ranges in turn and runs the analyzer on each of their
+ * blocks, with its own analyzer state, so the ranges are analysed in
+ * parallel on all the cores.
+ *
+ * The analyzer keeps state from block to block (filters, overlapped
+ * frames, speed history): a range starts from a reset state and is
+ * preceded by warm-up blocks (BATCH_WARMUP_BLOCKS, or as many as the
+ * analyzer needs) analysed only to bring that state up to date (their
+ * results are dropped). The result of a block
+ * does not depend on the number of workers.
+ *
+ * Each result is stored at the index of its block, so the results are
+ * merged in time order as the ranges complete, and written at the end
+ * to the results file:
+ *    header: char magic[8] = "RTBATCH", uint32 version, uint32 record
+ *            size, uint32 sampling frequency, uint32 N, uint64 blocks
+ *    then one batchResult per block, in block order
+ * (batch2csv.py converts it to CSV)
+ * ************************************************************/
+
+#ifndef _BATCH_H
+#define _BATCH_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define BATCH_VERSION 1
+#define BATCH_RANGE_BLOCKS 128      /* Blocks per range (~12 s at 4096 samples, 44.1 kHz) */
+#define BATCH_WARMUP_BLOCKS 8       /* Analysed before a range, results dropped (minimum) */
+#define BATCH_MAX_JOBS 256
+
+/* Result of one block (24 bytes, little endian in the file) */
+typedef struct {
+    uint32_t block;             /* Block number (1, 2, ...), block k starts at sample (k-1)*N */
+    float speedHz;              /* Speed: frequency of the strongest low band peak */
+    float speedAmp;             /* Speed: its amplitude */
+    float issueHz;              /* Issue: frequency of the strongest high band peak */
+    float issueRatio;           /* Issue: high band / speed band amplitude */
+    int8_t direction;           /* Direction: 1 accelerating, -1 decelerating, 2 stable, 0 stopped */
+    uint8_t issue;              /* Issue: fault detected */
+    uint16_t reserved;
+} batchResult;
+
+/* Per-block analysis; one state per worker, stateSize bytes (zeroed,
+ * 64-byte aligned) */
+typedef struct {
+    size_t stateSize;
+    int (*init)(void *state);                   /* Once per worker, != 0: fails the run */
+    void (*reset)(void *state);                 /* Before each range (and its warm-up) */
+    void (*block)(void *state, const uint16_t *x, batchResult *r);  /* N samples, as captured (U16) */
+    void (*destroy)(void *state);               /* Once per worker (NULL: none) */
+    int warmupBlocks;                           /* History the state needs (< BATCH_WARMUP_BLOCKS: that) */
+} batchAnalyzer;
+
+/* Totals of a run */
+typedef struct {
+    uint64_t blocks;
+    int jobs;
+    int ranges;
+    double audioSec;
+    double wallSec;
+    double cpuSec;              /* Sum of the workers' thread CPU time */
+} batchReport;
+
+/* *******************************************************************
+ * Analyses a recording
+ * Args are:
+ * 		const char *wavPath: 16-bit PCM WAV at fs (first channel used)
+ * 		const char *outPath: results file
+ * 		int fs: sampling frequency
+ * 		int N: samples per block
+ * 		int jobs: worker threads (0: one per online CPU)
+ * 		const batchAnalyzer *a: the analysis of one block
+ * 		batchReport *rep: output, totals
+ * Returns 0, or -1 (message on stderr)
+ * *******************************************************************/
+int batchRun(const char *wavPath, const char *outPath, int fs, int N, int jobs,
+             const batchAnalyzer *a, batchReport *rep);
+
+/* *******************************************************************
+ * Prints the totals and the throughput (audio seconds per wall second)
+ * *******************************************************************/
+void batchPrintReport(FILE *f, const batchReport *rep);
+
+#endif
@@ -0,0 +1,44 @@
+#!/usr/bin/env python3
+# Converts the results file written by rtsounds -batch (batch/batch.h)
+# to CSV, one line per block.
+#
+# Usage: python3 batch2csv.py [rtsounds_batch.bin] [batch_results.csv]
+
+import struct
+import sys
+
+HEADER = struct.Struct('<8sIIIIQ')         # magic, version, record size, fs, N, blocks
+RESULT = struct.Struct('<IffffbBH')        # block, speed Hz/amp, issue Hz/ratio, direction, issue, reserved
+DIRECTIONS = {1: 'ACCEL', -1: 'DECEL', 2: 'STABLE', 0: 'STOP'}
+
+
+def convert(src, dst):
+    with open(src, 'rb') as f:
+        data = f.read()
+
+    magic, version, size, fs, n, blocks = HEADER.unpack_from(data, 0)
+    if magic.rstrip(b'\0') != b'RTBATCH' or version != 1 or size != RESULT.size:
+        sys.exit(f"Error: '{src}' is not a version 1 rtsounds batch results file")
+
+    faults = 0
+    with open(dst, 'w') as out:
+        out.write('# Block,TimeSec,SpeedHz,SpeedAmp,Direction,Issue,IssueHz,IssueRatio\n')
+        for i in range(blocks):
+            block, speed, amp, issue_hz, ratio, direction, issue, _ = \
+                RESULT.unpack_from(data, HEADER.size + i * size)
+            out.write('%d,%.4f,%.2f,%.1f,%s,%d,%.1f,%.4f\n' % (
+                block, (block - 1) * n / fs, speed, amp,
+                DIRECTIONS.get(direction, str(direction)), issue, issue_hz, ratio))
+            faults += issue
+
+    print(f"{blocks} blocks ({blocks * n / fs:.1f} s, {faults} with a fault) written to {dst}")
+
+
+def main():
+    src = sys.argv[1] if len(sys.argv) > 1 else 'rtsounds_batch.bin'
+    dst = sys.argv[2] if len(sys.argv) > 2 else 'batch_results.csv'
+    convert(src, dst)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,114 @@
+/* ************************************************************
+ * CAB stress test
+ *
+ * One writer thread and N reader threads share a CAB of N + 2 slots
+ * (rt/cab.h). The writer fills each message with its sequence number,
+ * in every word, and publishes it; the readers take the latest message
+ * and check every word while holding it, again after yielding the CPU
+ * to the writer (so one CPU is enough to catch a reused slot). Two
+ * different words mean the writer reused a slot a reader held (torn
+ * read); an older message than before means a reader did not get the
+ * latest one. The writer fails if no slot is free.
+ *
+ * Usage: ./bench/cab_stress [readers] [seconds]
+ * Exits with 1 on the first failure, 0 otherwise.
+ * ************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include "../rt/cab.h"
+
+#define MAX_READERS (CAB_MAX_SLOTS - 2)
+#define MSG_WORDS 512                   /* 4 KB messages, like an audio block */
+
+static uint64_t msg[CAB_MAX_SLOTS][MSG_WORDS];
+static cabCtrl cab;
+static atomic_int running = 1;
+static atomic_int failed;
+static atomic_ullong reads;
+
+static void fail(const char *what, int who, uint64_t a, uint64_t b) {
+    if (atomic_exchange(&failed, 1) == 0) {
+        fprintf(stderr, "FAIL: %s (thread %d: %llu, %llu)\n", what, who,
+                (unsigned long long)a, (unsigned long long)b);
+    }
+    atomic_store(&running, 0);
+}
+
+/* Every word of slot i must still be seq */
+static void checkMessage(int i, uint64_t seq, int who) {
+    for (int w = 0; w < MSG_WORDS; w++) {
+        uint64_t v = atomic_load_explicit((_Atomic uint64_t *)&msg[i][w], memory_order_relaxed);
+        if (v != seq) fail("torn read", who, seq, v);
+    }
+}
+
+static void *writer(void *arg) {
+    uint64_t seq = 0;
+
+    (void)arg;
+    while (atomic_load(&running)) {
+        int i = cabCtrl_getWriteSlot(&cab);
+        if (i < 0) {
+            fail("no free write slot", -1, seq, 0);
+            break;
+        }
+        seq++;
+        for (int w = 0; w < MSG_WORDS; w++) {
+            atomic_store_explicit((_Atomic uint64_t *)&msg[i][w], seq, memory_order_relaxed);
+        }
+        cabCtrl_publish(&cab, i);
+    }
+    return NULL;
+}
+
+static void *reader(void *arg) {
+    int id = (int)(intptr_t)arg;
+    uint64_t last = 0, n = 0;
+
+    while (atomic_load(&running)) {
+        int i = cabCtrl_getReadSlot(&cab);
+        uint64_t first = atomic_load_explicit((_Atomic uint64_t *)&msg[i][0], memory_order_relaxed);
+        checkMessage(i, first, id);
+        if (first < last) fail("older message than the previous one", id, last, first);
+        last = first;
+        if ((++n & 15) == 0) {
+            sched_yield();  /* Hold the slot while the writer runs, even on one CPU */
+            checkMessage(i, first, id);
+        }
+        cabCtrl_release(&cab, i);
+    }
+    atomic_fetch_add(&reads, n);
+    return NULL;
+}
+
+int main(int argc, char *argv[]) {
+    int nreaders = (argc > 1) ? atoi(argv[1]) : 4;
+    int seconds = (argc > 2) ? atoi(argv[2]) : 5;
+    pthread_t w, r[MAX_READERS];
+
+    if (nreaders < 1 || nreaders > MAX_READERS || seconds < 1) {
+        fprintf(stderr, "Usage: %s [readers 1..%d] [seconds]\n", argv[0], MAX_READERS);
+        return 2;
+    }
+    cabCtrl_init(&cab, nreaders + 2);
+
+    pthread_create(&w, NULL, writer, NULL);
+    for (int i = 0; i < nreaders; i++) {
+        pthread_create(&r[i], NULL, reader, (void *)(intptr_t)i);
+    }
+    struct timespec t = { seconds, 0 };
+    while (atomic_load(&running) && nanosleep(&t, &t) != 0);
+    atomic_store(&running, 0);
+    pthread_join(w, NULL);
+    for (int i = 0; i < nreaders; i++) pthread_join(r[i], NULL);
+
+    printf("CAB stress: %d readers, %d slots, %d s: %llu reads, %s\n", nreaders, nreaders + 2,
+           seconds, (unsigned long long)atomic_load(&reads), atomic_load(&failed) ? "FAILED" : "ok");
+    return atomic_load(&failed) ? 1 : 0;
+}
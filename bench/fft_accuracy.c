@@ -0,0 +1,203 @@
+/* ************************************************************
+ * Single vs double precision FFT accuracy
+ *
+ * Generates the signalgen test scenarios as raw 16-bit audio, splits
+ * them in blocks of N samples (as the capture does) and runs each block
+ * through fftExecuteRealU16() and fftExecuteRealU16F(). For each
+ * scenario it reports:
+ *    - blocks whose largest peak (DC excluded) lands in a different bin
+ *    - blocks whose 3 largest peaks differ (as a set)
+ *    - the max relative error of the amplitude at the largest peak
+ *    - the max error of any bin, relative to the largest peak
+ *
+ * The fault and harmonics scenarios add their extra tones, which
+ * signalgen itself does not do yet (addSineU16 is a placeholder).
+ *
+ * Usage: ./bench/fft_accuracy [N]   (default 4096, power of 2)
+ * ************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <complex.h>
+#include "../fft/fft.h"
+
+#define SAMP_FREQ 44100
+#define MAX_SECONDS 10
+#define NPEAKS 3
+
+typedef enum {
+    TEST_CONSTANT_SPEED, TEST_ACCELERATION, TEST_DECELERATION,
+    TEST_WITH_FAULT, TEST_START_STOP, TEST_MULTIPLE_HARMONICS,
+    TEST_COUNT
+} TestScenario;
+
+static const char *scenarioName[TEST_COUNT] = {
+    "constant 300 Hz", "chirp 300->500 Hz", "chirp 500->300 Hz",
+    "420 Hz + 3 kHz fault", "start/stop", "harmonics 80/160/240"
+};
+
+/* Signal in centered units (added to 32768 when converted to U16) */
+static void addSine(double *x, double freq, double amp, int offset, int n) {
+    for (int i = 0; i < n; i++) {
+        x[offset + i] += amp / 2 * sin(2.0 * M_PI * freq * i / SAMP_FREQ);
+    }
+}
+
+static void addChirp(double *x, double f0, double f1, double amp, int offset, int n) {
+    double phase = 0.0;
+    for (int i = 0; i < n; i++) {
+        phase += 2.0 * M_PI * (f0 + (f1 - f0) * ((double)i / n)) / SAMP_FREQ;
+        x[offset + i] += amp / 2 * sin(phase);
+    }
+}
+
+static int msToSamples(int ms) {
+    return (int)((long)ms * SAMP_FREQ / 1000);
+}
+
+/* Same scenarios (frequencies, durations, amplitudes) as signalgen.c */
+static int generate(TestScenario scenario, double *x) {
+    int n = 0, off = 0;
+
+    memset(x, 0, MAX_SECONDS * SAMP_FREQ * sizeof(double));
+    switch (scenario) {
+    case TEST_CONSTANT_SPEED:
+        n = msToSamples(10000);
+        addSine(x, 300.0, 30000, 0, n);
+        break;
+    case TEST_ACCELERATION:
+        n = msToSamples(8000);
+        addChirp(x, 300.0, 500.0, 30000, 0, n);
+        break;
+    case TEST_DECELERATION:
+        n = msToSamples(8000);
+        addChirp(x, 500.0, 300.0, 30000, 0, n);
+        break;
+    case TEST_WITH_FAULT:
+        n = msToSamples(10000);
+        addSine(x, 420.0, 30000, 0, n);
+        for (int b = 0; b < 10000 / 100; b += 2) {   // 100 ms bursts, every other slot
+            addSine(x, 3000.0, 12000, msToSamples(b * 100), msToSamples(100));
+        }
+        break;
+    case TEST_START_STOP:
+        off = msToSamples(1000);
+        addChirp(x, 0.0, 150.0, 30000, off, msToSamples(2000));
+        off += msToSamples(2000);
+        addSine(x, 150.0, 30000, off, msToSamples(3000));
+        off += msToSamples(3000);
+        addChirp(x, 150.0, 0.0, 30000, off, msToSamples(2000));
+        n = off + msToSamples(2000) + msToSamples(2000);
+        break;
+    case TEST_MULTIPLE_HARMONICS:
+        n = msToSamples(10000);
+        addSine(x, 80.0, 20000, 0, n);
+        addSine(x, 160.0, 15000, 0, n);
+        addSine(x, 240.0, 10000, 0, n);
+        break;
+    default:
+        break;
+    }
+    return n;
+}
+
+/* Indices of the NPEAKS largest bins in 1 .. n-1, sorted by bin */
+static void topPeaks(const double *A, int n, int *peak) {
+    for (int p = 0; p < NPEAKS; p++) {
+        int best = -1;
+        for (int k = 1; k < n; k++) {
+            int taken = 0;
+            for (int q = 0; q < p; q++) taken |= (peak[q] == k);
+            if (!taken && (best < 0 || A[k] > A[best])) best = k;
+        }
+        peak[p] = best;
+    }
+    for (int p = 1; p < NPEAKS; p++) {
+        for (int q = p; q > 0 && peak[q] < peak[q - 1]; q--) {
+            int t = peak[q]; peak[q] = peak[q - 1]; peak[q - 1] = t;
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int N = (argc > 1) ? atoi(argv[1]) : 4096;
+    int nbins = N / 2 + 1;
+
+    fftRealPlan *plan = fftRealPlanCreate(N);
+    fftRealPlanF *planF = fftRealPlanCreateF(N);
+    double *x = malloc(MAX_SECONDS * SAMP_FREQ * sizeof(double));
+    uint16_t *u = malloc(MAX_SECONDS * SAMP_FREQ * sizeof(uint16_t));
+    complex double *X = malloc(nbins * sizeof(complex double));
+    complex float *XF = malloc(nbins * sizeof(complex float));
+    double *A = malloc(nbins * sizeof(double));
+    double *AF = malloc(nbins * sizeof(double));
+    if (plan == NULL || planF == NULL) {
+        fprintf(stderr, "Invalid N (%d): must be a power of 2, >= 4\n", N);
+        return 1;
+    }
+    if (x == NULL || u == NULL || X == NULL || XF == NULL || A == NULL || AF == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    printf("N = %d, fs = %d Hz, bin = %.2f Hz\n", N, SAMP_FREQ, (double)SAMP_FREQ / N);
+    printf("%-22s %7s %10s %10s %14s %14s\n",
+           "scenario", "blocks", "peak diff", "top3 diff", "peak amp err", "max bin err");
+
+    for (int s = 0; s < TEST_COUNT; s++) {
+        int n = generate((TestScenario)s, x);
+        int blocks = n / N, peakDiff = 0, topDiff = 0;
+        double peakErr = 0.0, binErr = 0.0;
+
+        for (int i = 0; i < n; i++) {
+            u[i] = (uint16_t)(32768 + (int16_t)x[i]);   // Truncated, as in signalgen
+        }
+
+        for (int b = 0; b < blocks; b++) {
+            const uint16_t *blk = u + (long)b * N;
+            int peak[NPEAKS], peakF[NPEAKS];
+
+            fftExecuteRealU16(plan, blk, 32768.0, X);
+            fftExecuteRealU16F(planF, blk, 32768.0f, XF);
+            for (int k = 0; k < nbins; k++) {
+                A[k] = 2.0 / N * cabs(X[k]);
+                AF[k] = 2.0 / N * cabsf(XF[k]);
+            }
+
+            topPeaks(A, nbins, peak);
+            topPeaks(AF, nbins, peakF);
+
+            int top = 1, topF = 1;
+            for (int k = 2; k < nbins; k++) {
+                if (A[k] > A[top]) top = k;
+                if (AF[k] > AF[topF]) topF = k;
+            }
+            peakDiff += (top != topF);
+            topDiff += (memcmp(peak, peakF, sizeof(peak)) != 0);
+
+            if (A[top] > 0.0) {
+                double e = fabs(AF[top] - A[top]) / A[top];
+                if (e > peakErr) peakErr = e;
+                for (int k = 0; k < nbins; k++) {
+                    e = fabs(AF[k] - A[k]) / A[top];
+                    if (e > binErr) binErr = e;
+                }
+            }
+        }
+
+        printf("%-22s %7d %10d %10d %14.3g %14.3g\n",
+               scenarioName[s], blocks, peakDiff, topDiff, peakErr, binErr);
+    }
+
+    fftRealPlanDestroy(plan);
+    fftRealPlanDestroyF(planF);
+    free(x);
+    free(u);
+    free(X);
+    free(XF);
+    free(A);
+    free(AF);
+    return 0;
+}
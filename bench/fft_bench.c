@@ -0,0 +1,166 @@
+/* ************************************************************
+ * FFT microbenchmark
+ *
+ * Measures the per-call latency of the FFT for N = 1024 .. 65536:
+ *    - the original recursive implementation (reference)
+ *    - the fftCompute() compatibility wrapper
+ *    - fftExecute() with a plan created up-front
+ *    - fftExecuteRealU16() on the same samples as raw 16-bit audio
+ *    - fftExecuteRealU16F(), its single-precision version
+ * and checks that the plan outputs match the reference.
+ *
+ * Usage: ./bench/fft_bench [iterations]
+ * ************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include <complex.h>
+#include "../fft/fft.h"
+
+#define NS_IN_SEC 1000000000L
+#define MIN_N 1024
+#define MAX_N 65536
+
+/* Original recursive version, kept here as the reference */
+static void fftComputeRecursive(complex double *X, int N) {
+    if (N <= 1) return;
+
+    complex double even[N/2];
+    complex double odd[N/2];
+
+    for (int i = 0; i < N/2; i++) {
+        even[i] = X[i * 2];
+        odd[i] = X[i * 2 + 1];
+    }
+
+    fftComputeRecursive(even, N/2);
+    fftComputeRecursive(odd, N/2);
+
+    for (int k = 0; k < N/2; k++) {
+        complex double t = cexp(-2.0 * I * M_PI * k / N) * odd[k];
+        X[k]       = even[k] + t;
+        X[k + N/2] = even[k] - t;
+    }
+}
+
+static double nowNs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * NS_IN_SEC + ts.tv_nsec;
+}
+
+/* Test signal: two tones plus an offset, as 16-bit audio would give */
+static double signalAt(int k) {
+    return 12000.0 * sin(2.0 * M_PI * 440.0 * k / 44100.0)
+         + 3000.0 * sin(2.0 * M_PI * 3000.0 * k / 44100.0) + 100.0;
+}
+
+static void fillSignal(complex double *x, int N) {
+    for (int k = 0; k < N; k++) {
+        x[k] = signalAt(k);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int iters = (argc > 1) ? atoi(argv[1]) : 50;
+    if (iters < 1) iters = 1;
+
+    complex double *x = malloc(MAX_N * sizeof(complex double));
+    complex double *ref = malloc(MAX_N * sizeof(complex double));
+    complex double *Xr = malloc((MAX_N/2 + 1) * sizeof(complex double));
+    complex float *Xf = malloc((MAX_N/2 + 1) * sizeof(complex float));
+    uint16_t *u = malloc(MAX_N * sizeof(uint16_t));
+    if (x == NULL || ref == NULL || Xr == NULL || Xf == NULL || u == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    printf("%8s %14s %14s %14s %14s %14s %10s %10s %10s %10s\n",
+           "N", "recursive[us]", "fftCompute[us]", "fftExecute[us]", "real U16[us]",
+           "real U16F[us]", "rec/real", "err", "err real", "err realF");
+
+    for (int N = MIN_N; N <= MAX_N; N *= 2) {
+        fftPlan *plan = fftPlanCreate(N);
+        fftRealPlan *rplan = fftRealPlanCreate(N);
+        fftRealPlanF *fplan = fftRealPlanCreateF(N);
+        if (plan == NULL || rplan == NULL || fplan == NULL) {
+            fprintf(stderr, "fftPlanCreate(%d) failed\n", N);
+            return 1;
+        }
+
+        double t0, tRec = 0, tWrap = 0, tPlan = 0, tReal = 0, tRealF = 0;
+
+        for (int k = 0; k < N; k++) {
+            u[k] = (uint16_t)lround(signalAt(k) + 32768.0);
+        }
+
+        fftCompute(x, N);   // Warm-up: builds the cached plan
+        for (int i = 0; i < iters; i++) {
+            fillSignal(ref, N);
+            t0 = nowNs();
+            fftComputeRecursive(ref, N);
+            tRec += nowNs() - t0;
+
+            fillSignal(x, N);
+            t0 = nowNs();
+            fftCompute(x, N);
+            tWrap += nowNs() - t0;
+
+            fillSignal(x, N);
+            t0 = nowNs();
+            fftExecute(plan, x);
+            tPlan += nowNs() - t0;
+
+            t0 = nowNs();
+            fftExecuteRealU16(rplan, u, 32768.0, Xr);
+            tReal += nowNs() - t0;
+
+            t0 = nowNs();
+            fftExecuteRealU16F(fplan, u, 32768.0f, Xf);
+            tRealF += nowNs() - t0;
+        }
+
+        double maxErr = 0.0;
+        for (int k = 0; k < N; k++) {
+            double e = cabs(x[k] - ref[k]);
+            if (e > maxErr) maxErr = e;
+        }
+
+        /* The U16 input is rounded, so compare against the plan output
+         * of the same rounded samples */
+        for (int k = 0; k < N; k++) {
+            x[k] = (double)u[k] - 32768.0;
+        }
+        fftExecute(plan, x);
+        double maxErrReal = 0.0, maxErrRealF = 0.0;
+        for (int k = 0; k <= N/2; k++) {
+            double e = cabs(Xr[k] - x[k]);
+            if (e > maxErrReal) maxErrReal = e;
+            e = cabs((complex double)Xf[k] - x[k]);
+            if (e > maxErrRealF) maxErrRealF = e;
+        }
+
+        tRec /= iters * 1000.0;
+        tWrap /= iters * 1000.0;
+        tPlan /= iters * 1000.0;
+        tReal /= iters * 1000.0;
+        tRealF /= iters * 1000.0;
+        printf("%8d %14.1f %14.1f %14.1f %14.1f %14.1f %9.1fx %10.3g %10.3g %10.3g\n",
+               N, tRec, tWrap, tPlan, tReal, tRealF, tRec / tReal,
+               maxErr, maxErrReal, maxErrRealF);
+
+        fftPlanDestroy(plan);
+        fftRealPlanDestroy(rplan);
+        fftRealPlanDestroyF(fplan);
+    }
+
+    free(x);
+    free(ref);
+    free(Xr);
+    free(Xf);
+    free(u);
+    return 0;
+}
@@ -0,0 +1,137 @@
+/* ************************************************************
+ * Issue decision: Goertzel band engine vs full FFT
+ *
+ * Times one Issue decision (largest amplitude above 2 kHz vs largest
+ * below) computed from:
+ *    - the full spectrum: real FFT of the block + amplitudes + two
+ *      band searches (Issue_thread only does the searches: the
+ *      spectrum in spec_buffer is computed once for all the tasks)
+ *    - goertzelBank over the configured bands, for several block
+ *      lengths and band sets
+ * on blocks with and without a fault tone (3, 6, 12 or 18 kHz in turn),
+ * and counts the decisions that differ from the full-spectrum ones: a
+ * bank whose upper band stops below fs/2 misses the faults above it.
+ *
+ * Usage: ./bench/goertzel_bench [blocks]   (default 200)
+ * ************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include <complex.h>
+#include "../fft/fft.h"
+#include "../dsp/goertzel.h"
+#include "../dsp/kernels.h"
+
+#define NS_IN_SEC 1000000000L
+#define SAMP_FREQ 44100
+#define N 4096
+#define ISSUE_FREQ_THRESHOLD 2000.0
+
+typedef struct {
+    const char *name;
+    int len;                        /* Block length (last len samples of the block) */
+    goertzelBandConfig bands[2];    /* Below / above the threshold */
+} config;
+
+static const config configs[] = {
+    { "4096, 20..5000 Hz",  4096, { { 20.0, 1990.0 }, { 2000.0, 5000.0 } } },
+    { "1024, 20..8000 Hz",  1024, { { 20.0, 1990.0 }, { 2000.0, 8000.0 } } },
+    { "1024, 20..5000 Hz",  1024, { { 20.0, 1990.0 }, { 2000.0, 5000.0 } } },
+    { "512, 20..20000 Hz",   512, { { 20.0, 1990.0 }, { 2000.0, 20000.0 } } },
+    { "1024, 20..22050 Hz", 1024, { { 20.0, 1990.0 }, { 2000.0, SAMP_FREQ / 2.0 } } },
+};
+#define NCONF (int)(sizeof(configs) / sizeof(configs[0]))
+
+static double nowNs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * NS_IN_SEC + ts.tv_nsec;
+}
+
+/* Same rule as Issue_thread */
+static int decide(float maxHigh, float maxLow) {
+    float ratio = (maxLow > 0) ? (maxHigh / maxLow) : 0.0;
+    return (ratio > 0.15 && maxHigh > 8000.0);
+}
+
+/* Speed tone, plus a fault tone on odd blocks, plus noise */
+static void fillBlock(uint16_t *u, int block) {
+    static const double fFault[] = { 3000.0, 6000.0, 12000.0, 18000.0 };
+    double fSpeed = 300.0 + 2.0 * (block % 100);
+    double fIssue = fFault[(block / 2) % 4];
+    for (int i = 0; i < N; i++) {
+        long n = (long)block * N + i;
+        double v = 12000.0 * sin(2.0 * M_PI * fSpeed * n / SAMP_FREQ)
+                 + 200.0 * (rand() / (double)RAND_MAX - 0.5);
+        if (block & 1) v += 14000.0 * sin(2.0 * M_PI * fIssue * n / SAMP_FREQ);
+        u[i] = (uint16_t)lround(32768.0 + v);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int blocks = (argc > 1) ? atoi(argv[1]) : 200;
+    if (blocks < 1) blocks = 1;
+    kernelsIsa isa = kernelsInit();
+
+    static goertzelBank bank[NCONF];
+    fftRealPlan *plan = fftRealPlanCreate(N);
+    complex double X[N/2 + 1];
+    float Ak[N/2 + 1];
+    uint16_t u[N];
+    int kThr = (int)ceil(ISSUE_FREQ_THRESHOLD * N / SAMP_FREQ);
+
+    if (plan == NULL) {
+        fprintf(stderr, "fftRealPlanCreate(%d) failed\n", N);
+        return 1;
+    }
+    for (int c = 0; c < NCONF; c++) {
+        if (goertzelInit(&bank[c], configs[c].bands, 2, configs[c].len, SAMP_FREQ) != 0) {
+            fprintf(stderr, "Invalid band configuration: %s\n", configs[c].name);
+            return 1;
+        }
+    }
+
+    double tFft = 0.0, tG[NCONF] = { 0 };
+    int faults = 0, faultsG[NCONF] = { 0 }, diff[NCONF] = { 0 };
+
+    srand(1);
+    for (int b = 0; b < blocks; b++) {
+        fillBlock(u, b);
+
+        double t0 = nowNs();
+        fftExecuteRealU16(plan, u, 32768.0, X);
+        for (int k = 0; k <= N/2; k++) Ak[k] = 2.0 / N * cabs(X[k]);
+        int kLow = 1, kHigh = kThr;
+        for (int k = 2; k < kThr; k++) if (Ak[k] > Ak[kLow]) kLow = k;
+        for (int k = kThr + 1; k <= N/2; k++) if (Ak[k] > Ak[kHigh]) kHigh = k;
+        int ref = decide(Ak[kHigh], Ak[kLow]);
+        tFft += nowNs() - t0;
+        faults += ref;
+
+        for (int c = 0; c < NCONF; c++) {
+            int len = configs[c].len;
+            t0 = nowNs();
+            goertzelReset(&bank[c]);
+            goertzelPushU16(&bank[c], u + N - len, len, 32768.0);
+            int dec = decide(goertzelBandMax(&bank[c], 1, NULL), goertzelBandMax(&bank[c], 0, NULL));
+            tG[c] += nowNs() - t0;
+            faultsG[c] += dec;
+            diff[c] += (dec != ref);
+        }
+    }
+
+    printf("%d blocks of %d samples, fault tone on every other block, kernels: %s\n",
+           blocks, N, kernelsIsaName(isa));
+    printf("%-24s %6s %14s %8s %10s\n", "engine", "bins", "decision[us]", "faults", "differ");
+    printf("%-24s %6d %14.1f %8d %10s\n", "FFT 4096, full", N/2 + 1, tFft / blocks / 1000.0, faults, "-");
+    for (int c = 0; c < NCONF; c++) {
+        printf("%-24s %6d %14.1f %8d %10d\n", configs[c].name, bank[c].nbins,
+               tG[c] / blocks / 1000.0, faultsG[c], diff[c]);
+    }
+
+    fftRealPlanDestroy(plan);
+    return 0;
+}
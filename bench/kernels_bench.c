@@ -0,0 +1,146 @@
+/* ************************************************************
+ * Kernel microbenchmark
+ *
+ * Runs every kernel of dsp/kernels.h with each instruction set the
+ * CPU supports, on audio-sized data (4096 samples, 2049 bins), and
+ * reports the time per call, the speedup over the scalar version and
+ * the largest difference to the scalar results. The versions round
+ * differently (operation order, sqrt(a^2+b^2) against cabs), so each
+ * kernel has a tolerance: absolute for the samples, relative (to
+ * max(1, |scalar|)) for the bins and the Goertzel states, 0 for the
+ * exact ones.
+ *
+ * Usage: ./bench/kernels_bench [iterations]
+ * Exits with 1 if a version differs from the scalar one by more than
+ * the tolerance of its kernel.
+ * ************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include <complex.h>
+#include "../dsp/kernels.h"
+
+#define NS_IN_SEC 1000000000L
+#define N 4096
+#define NBINS (N/2 + 1)
+#define GN 1024                  /* Goertzel: samples, bins */
+#define GBINS 64
+
+static uint16_t samples[N];
+static complex double X[NBINS];
+static complex float XF[NBINS];
+static float A[NBINS], W[NBINS];
+
+static double outD[N], refD[N];
+static float outFN[N], refFN[N];
+static float outF[NBINS], refF[NBINS];
+static int outI, refI;
+static double gCoef[GBINS], outG[2 * GBINS], refG[2 * GBINS];
+static volatile int sink;
+
+static double nowNs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * NS_IN_SEC + ts.tv_nsec;
+}
+
+static void runConvert(void)   { kConvertCenterU16(samples, 32768.0, outD, N); }
+static void runWindow(void)    { kApplyWindow(A, W, outF, NBINS); }
+static void runAmp(void)       { kAmplitude(X, outF, NBINS, 2.0 / N); }
+static void runConvertF(void)  { kConvertCenterU16F(samples, 32768.0f, outFN, N); }
+static void runAmpF(void)      { kAmplitudeF(XF, outF, NBINS, 2.0f / N); }
+static void runArgmax(void)    { outI = kArgmaxBand(A, 1, NBINS - 1); sink = outI; }
+static void runGoertzel(void) {
+    memset(outG, 0, sizeof(outG));
+    kGoertzelU16(samples, GN, 32768.0, gCoef, outG, outG + GBINS, GBINS);
+}
+
+typedef struct {
+    const char *name;
+    void (*run)(void);
+    int out;                     /* 0: outD[N], 1: outF[NBINS], 2: outI, 3: outFN[N], 4: outG */
+    double tol;                  /* Largest difference to the scalar version */
+} benchKernel;
+
+static const benchKernel kernels[] = {
+    { "convert-center U16", runConvert,  0, 0.0 },
+    { "apply window",       runWindow,   1, 0.0 },
+    { "amplitude",          runAmp,      1, 1e-6 },
+    { "argmax in band",     runArgmax,   2, 0.0 },
+    { "convert-center (f)", runConvertF, 3, 0.0 },
+    { "amplitude (f)",      runAmpF,     1, 1e-6 },
+    { "goertzel U16",       runGoertzel, 4, 1e-9 },
+};
+
+static double maxDiff(int out) {
+    double d = 0.0;
+    if (out == 0) {
+        for (int i = 0; i < N; i++) d = fmax(d, fabs(outD[i] - refD[i]));
+    } else if (out == 1) {
+        for (int i = 0; i < NBINS; i++) d = fmax(d, fabs(outF[i] - refF[i]) / fmax(1.0, fabs(refF[i])));
+    } else if (out == 3) {
+        for (int i = 0; i < N; i++) d = fmax(d, fabs(outFN[i] - refFN[i]));
+    } else if (out == 4) {
+        for (int i = 0; i < 2 * GBINS; i++) d = fmax(d, fabs(outG[i] - refG[i]) / fmax(1.0, fabs(refG[i])));
+    } else {
+        d = (outI != refI);
+    }
+    return d;
+}
+
+int main(int argc, char *argv[]) {
+    int iters = (argc > 1) ? atoi(argv[1]) : 20000;
+    if (iters < 1) iters = 1;
+
+    srand(1);
+    for (int i = 0; i < N; i++) {
+        samples[i] = (uint16_t)(32768 + 12000 * sin(2 * M_PI * 440.0 * i / 44100.0) + rand() % 2000 - 1000);
+    }
+    for (int k = 0; k < NBINS; k++) {
+        X[k] = CMPLX(rand() % 20000 - 10000.0, rand() % 20000 - 10000.0);
+        XF[k] = CMPLXF((float)creal(X[k]), (float)cimag(X[k]));
+        A[k] = (float)(rand() % 100000) / 7.0f;
+        W[k] = 0.5f - 0.5f * cosf(2.0f * M_PI * k / NBINS);
+    }
+    for (int j = 0; j < GBINS; j++) {
+        gCoef[j] = 2.0 * cos(2.0 * M_PI * (3 + 7 * j) / GN);
+    }
+    int failed = 0;
+
+    printf("Best kernel set for this CPU: %s\n", kernelsIsaName(kernelsInit()));
+    printf("%-20s %-8s %12s %10s %12s %10s\n", "kernel", "isa", "ns/call", "speedup", "max diff", "tolerance");
+
+    for (size_t b = 0; b < sizeof(kernels) / sizeof(kernels[0]); b++) {
+        double tScalar = 0.0;
+
+        for (kernelsIsa isa = KERNELS_SCALAR; isa <= KERNELS_AVX2; isa++) {
+            if (kernelsSelect(isa) != 0) continue;
+
+            kernels[b].run();
+            if (isa == KERNELS_SCALAR) {
+                memcpy(refD, outD, sizeof(refD));
+                memcpy(refF, outF, sizeof(refF));
+                memcpy(refFN, outFN, sizeof(refFN));
+                memcpy(refG, outG, sizeof(refG));
+                refI = outI;
+            }
+
+            double t0 = nowNs();
+            for (int i = 0; i < iters; i++) {
+                kernels[b].run();
+            }
+            double t = (nowNs() - t0) / iters;
+            if (isa == KERNELS_SCALAR) tScalar = t;
+
+            double d = maxDiff(kernels[b].out);
+            int ok = (d <= kernels[b].tol);
+            failed |= !ok;
+            printf("%-20s %-8s %12.1f %9.2fx %12.3g %10.3g%s\n", kernels[b].name, kernelsIsaName(isa),
+                   t, tScalar / t, d, kernels[b].tol, ok ? "" : "  FAILED");
+        }
+    }
+    return failed;
+}
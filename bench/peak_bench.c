@@ -0,0 +1,141 @@
+/* ************************************************************
+ * Peak frequency estimation: interpolation vs larger FFTs
+ *
+ * Generates single tones at random frequencies (50 .. 1500 Hz, random
+ * phase, a little noise) as raw 16-bit audio and estimates their
+ * frequency from one block with:
+ *    - the bin of the largest amplitude, N and 2N points
+ *    - the peakInterpolate() methods on the N-point spectrum, either
+ *      unwindowed (as spec_buffer) or Hann-windowed (as the Speed STFT)
+ * For each estimator it reports the mean and max error (Hz) and the
+ * time per estimate (transform + amplitudes + peak search).
+ *
+ * Usage: ./bench/peak_bench [trials] [N]   (defaults 500, 4096)
+ * ************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include <complex.h>
+#include "../fft/fft.h"
+#include "../dsp/peak.h"
+
+#define NS_IN_SEC 1000000000L
+#define SAMP_FREQ 44100
+#define FMIN 50.0
+#define FMAX 1500.0
+
+typedef struct {
+    const char *name;
+    int scale;              /* Transform size, in multiples of N */
+    int hann;               /* Window the block */
+    peakMethod method;
+} estimator;
+
+static const estimator estimators[] = {
+    { "bin, N",              1, 0, PEAK_BIN },
+    { "bin, 2N",             2, 0, PEAK_BIN },
+    { "bin, 4N",             4, 0, PEAK_BIN },
+    { "quadratic, N",        1, 0, PEAK_QUADRATIC },
+    { "rect ratio, N",       1, 0, PEAK_RECT },
+    { "Hann quadratic, N",   1, 1, PEAK_QUADRATIC },
+    { "Hann gaussian, N",    1, 1, PEAK_GAUSSIAN },
+};
+#define NEST (int)(sizeof(estimators) / sizeof(estimators[0]))
+
+static double nowNs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * NS_IN_SEC + ts.tv_nsec;
+}
+
+static double uniform(double lo, double hi) {
+    return lo + (hi - lo) * rand() / (double)RAND_MAX;
+}
+
+/* Frequency (Hz) of the strongest tone in u[0 .. n-1] */
+static double estimate(const estimator *e, const fftRealPlan *plan, const uint16_t *u,
+                       int n, const double *w, double *x, complex double *X, float *A) {
+    if (e->hann) {
+        for (int i = 0; i < n; i++) x[i] = ((double)u[i] - 32768.0) * w[i];
+        fftExecuteReal(plan, x, X);
+    } else {
+        fftExecuteRealU16(plan, u, 32768.0, X);
+    }
+    for (int k = 0; k <= n/2; k++) A[k] = (float)cabs(X[k]);
+
+    int best = 1;
+    for (int k = 2; k <= n/2; k++) {
+        if (A[k] > A[best]) best = k;
+    }
+    return peakInterpolate(A, n/2 + 1, best, e->method, NULL) * SAMP_FREQ / n;
+}
+
+int main(int argc, char *argv[]) {
+    int trials = (argc > 1) ? atoi(argv[1]) : 500;
+    int N = (argc > 2) ? atoi(argv[2]) : 4096;
+    int maxN = 4 * N;
+    if (trials < 1) trials = 1;
+
+    fftRealPlan *plan[5] = { NULL };
+    for (int s = 1; s <= 4; s *= 2) {
+        plan[s] = fftRealPlanCreate(s * N);
+        if (plan[s] == NULL) {
+            fprintf(stderr, "Invalid N (%d): must be a power of 2, >= 4\n", N);
+            return 1;
+        }
+    }
+
+    uint16_t *u = malloc(maxN * sizeof(uint16_t));
+    double *x = malloc(maxN * sizeof(double));
+    double *w = malloc(N * sizeof(double));
+    complex double *X = malloc((maxN/2 + 1) * sizeof(complex double));
+    float *A = malloc((maxN/2 + 1) * sizeof(float));
+    if (u == NULL || x == NULL || w == NULL || X == NULL || A == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    for (int i = 0; i < N; i++) {
+        w[i] = 0.5 - 0.5 * cos(2.0 * M_PI * i / N);
+    }
+
+    double errSum[NEST] = { 0 }, errMax[NEST] = { 0 }, tSum[NEST] = { 0 };
+
+    srand(1);
+    for (int t = 0; t < trials; t++) {
+        double f = uniform(FMIN, FMAX), ph = uniform(0.0, 2.0 * M_PI);
+        for (int i = 0; i < maxN; i++) {
+            u[i] = (uint16_t)lround(32768.0 + 10000.0 * sin(2.0 * M_PI * f * i / SAMP_FREQ + ph)
+                                    + uniform(-100.0, 100.0));
+        }
+
+        for (int e = 0; e < NEST; e++) {
+            int n = estimators[e].scale * N;
+            double t0 = nowNs();
+            double fe = estimate(&estimators[e], plan[estimators[e].scale], u, n, w, x, X, A);
+            tSum[e] += nowNs() - t0;
+
+            double err = fabs(fe - f);
+            errSum[e] += err;
+            if (err > errMax[e]) errMax[e] = err;
+        }
+    }
+
+    printf("N = %d, fs = %d Hz, bin = %.2f Hz, %d tones in %.0f .. %.0f Hz\n",
+           N, SAMP_FREQ, (double)SAMP_FREQ / N, trials, FMIN, FMAX);
+    printf("%-20s %8s %14s %14s %12s\n", "estimator", "block", "mean err[Hz]", "max err[Hz]", "time[us]");
+    for (int e = 0; e < NEST; e++) {
+        printf("%-20s %8d %14.3f %14.3f %12.1f\n", estimators[e].name, estimators[e].scale * N,
+               errSum[e] / trials, errMax[e], tSum[e] / trials / 1000.0);
+    }
+
+    for (int s = 1; s <= 4; s *= 2) fftRealPlanDestroy(plan[s]);
+    free(u);
+    free(x);
+    free(w);
+    free(X);
+    free(A);
+    return 0;
+}
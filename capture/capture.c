@@ -0,0 +1,156 @@
+/* ************************************************************
+ * Headless capture backends: feeder thread and source selection
+ * ************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "capture.h"
+
+#define NS_IN_SEC 1000000000L
+
+static struct timespec tsAddNs(struct timespec t, int64_t ns) {
+    ns += t.tv_nsec;
+    t.tv_sec += ns / NS_IN_SEC;
+    t.tv_nsec = ns % NS_IN_SEC;
+    return t;
+}
+
+static double tsDiff(const struct timespec *a, const struct timespec *b) {
+    return (b->tv_sec - a->tv_sec) + (b->tv_nsec - a->tv_nsec) / 1e9;
+}
+
+int captureOpen(capture *c, const char *spec, int fs) {
+    memset(c, 0, sizeof(*c));
+    c->fs = fs;
+
+    if (strncmp(spec, "wav:", 4) == 0) {
+        return captureOpenWav(c, spec + 4, fs);
+    }
+    if (strncmp(spec, "raw:", 4) == 0) {
+        return captureOpenRaw(c, spec + 4);
+    }
+    if (strncmp(spec, "gen:", 4) == 0) {
+        char *end;
+        int scenario = (int)strtol(spec + 4, &end, 10);
+        double seconds = (*end == ':') ? atof(end + 1) : 0.0;
+        if (end == spec + 4 || (*end != '\0' && *end != ':')) {
+            fprintf(stderr, "Capture: bad generator '%s' (gen:SCENARIO[:SECONDS])\n", spec);
+            return -1;
+        }
+        return captureOpenGen(c, scenario, seconds, fs);
+    }
+    fprintf(stderr, "Capture: unknown source '%s' (wav:FILE, raw:FILE, raw:-, gen:SCENARIO)\n", spec);
+    return -1;
+}
+
+/* Waits for a publication on ack after seq, or the stop, or the end of
+ * the consumer. A block the consumer never acknowledges (e.g. dropped)
+ * holds the feeder for CAPTURE_ACK_TIMEOUT_MS at most */
+static void waitAck(capture *c, unsigned seq) {
+    for (int ms = 0; ms < CAPTURE_ACK_TIMEOUT_MS; ms += 100) {
+        if (notifySeq(c->ack) != seq || !atomic_load(&c->running) || atomic_load(&c->ack->closed)) return;
+
+        struct timespec limit;
+        clock_gettime(CLOCK_MONOTONIC, &limit);
+        limit = tsAddNs(limit, NS_IN_SEC / 10);  /* Re-checks running */
+        notifyWaitUntil(c->ack, seq, &limit);
+    }
+    c->ackTimeouts++;
+}
+
+static void *captureFeeder(void *arg) {
+    capture *c = arg;
+    static uint16_t block[CAPTURE_MAX_BLOCK];
+    const int64_t period = (int64_t)c->N * NS_IN_SEC / c->fs;
+    unsigned ackSeq = 0;
+    struct timespec next;
+    int ended = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    c->t0 = next;
+    while (atomic_load(&c->running)) {
+        int got = 0;
+        while (got < c->N) {
+            int r = c->read(c, block + got, c->N - got);
+            if (r > 0) {
+                got += r;
+            } else if (r == 0 && c->loop && c->rewind(c) == 0 && got + c->blocks > 0) {
+                continue;
+            } else {
+                break;
+            }
+        }
+        if (got < c->N) {   /* End of the source (a partial block is dropped) */
+            ended = 1;
+            break;
+        }
+
+        if (c->fast && c->ack != NULL) {
+            if (c->blocks >= (uint64_t)c->prime) waitAck(c, ackSeq);
+        } else {
+            /* A device delivers a block once it has been captured */
+            next = tsAddNs(next, period);
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL) == EINTR);
+        }
+        if (!atomic_load(&c->running)) break;
+
+        if (c->ack != NULL) ackSeq = notifySeq(c->ack);
+        c->callback(c->userdata, (uint8_t *)block, c->N * sizeof(uint16_t));
+        c->blocks++;
+        clock_gettime(CLOCK_MONOTONIC, &c->t1);
+    }
+
+    if (ended && c->onEnd != NULL) c->onEnd();
+    return NULL;
+}
+
+int captureStart(capture *c, int N, int fast, int loop, rtNotify *ack, int prime,
+                 captureCallback callback, void *userdata, void (*onEnd)(void)) {
+    if (N <= 0 || N > CAPTURE_MAX_BLOCK) return -1;
+
+    c->N = N;
+    c->fast = fast;
+    c->loop = loop;
+    c->ack = ack;
+    c->prime = (prime > 1) ? prime : 1;
+    c->callback = callback;
+    c->userdata = userdata;
+    c->onEnd = onEnd;
+    c->blocks = 0;
+    c->ackTimeouts = 0;
+    atomic_store(&c->running, 1);
+
+    int err = pthread_create(&c->thread, NULL, captureFeeder, c);
+    if (err != 0) {
+        atomic_store(&c->running, 0);
+        errno = err;
+        return -1;
+    }
+    c->started = 1;
+    return 0;
+}
+
+void captureStop(capture *c) {
+    atomic_store(&c->running, 0);
+    if (c->started) {
+        pthread_join(c->thread, NULL);
+        c->started = 0;
+    }
+    if (c->close != NULL) {
+        c->close(c);
+        c->close = NULL;
+    }
+}
+
+void captureReport(FILE *f, const capture *c) {
+    double audio = (double)c->blocks * c->N / c->fs;
+    double wall = (c->blocks > 0) ? tsDiff(&c->t0, &c->t1) : 0.0;
+
+    fprintf(f, "Capture %s (%s): %llu blocks, %.1f s of audio in %.2f s",
+            c->desc, c->fast ? "fast" : "real time", (unsigned long long)c->blocks, audio, wall);
+    if (wall > 0.0) fprintf(f, " (%.1fx real time)", audio / wall);
+    if (c->ackTimeouts > 0) fprintf(f, ", %llu blocks not acknowledged", (unsigned long long)c->ackTimeouts);
+    fprintf(f, "\n");
+}
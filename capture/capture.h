@@ -0,0 +1,133 @@
+/* ************************************************************
+ * Headless capture backends
+ *
+ * Stand-ins for the SDL capture device: a feeder thread reads blocks of
+ * N samples from a source and hands each one to the same callback SDL
+ * would call (audioRecordingCallback), as unsigned 16-bit mono samples.
+ *
+ * Sources (captureOpen spec):
+ *    wav:FILE      PCM WAV, 16-bit, at the capture rate (first channel)
+ *    raw:FILE      headerless signed 16-bit little-endian mono PCM,
+ *    raw:-         from a file or from stdin (e.g. arecord -t raw, sox)
+ *    gen:S[:SEC]   in-process test signal, scenario S of signalgen
+ *                  (0 .. 5), for SEC seconds (default: its own length)
+ *
+ * Pacing:
+ *    real time     block k is delivered N/fs after block k-1, as a
+ *                  device would (absolute-time sleeps)
+ *    fast          as fast as the consumer keeps up: block k+1 is
+ *                  delivered once the ack notification has been
+ *                  published after block k (e.g. the end of a job of
+ *                  the last task that handles each block), so the
+ *                  chain's maximum sustainable throughput is measured
+ *                  instead of the source's rate. The first prime
+ *                  blocks are delivered without waiting (blocks
+ *                  smaller than the consumer's frame: no ack until
+ *                  the first frame is complete)
+ * ************************************************************/
+
+#ifndef _CAPTURE_H
+#define _CAPTURE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+#include "../rt/notify.h"
+
+#define CAPTURE_MAX_BLOCK 8192      /* Samples per block */
+#define CAPTURE_ACK_TIMEOUT_MS 1000 /* fast: longest wait for a block to be consumed */
+
+typedef void (*captureCallback)(void *userdata, uint8_t *stream, int len);
+
+typedef struct capture capture;
+
+struct capture {
+    /* Source, set by captureOpen */
+    int (*read)(capture *c, uint16_t *x, int n);  /* Next n samples, returns the count (0: end, -1: error) */
+    int (*rewind)(capture *c);                    /* Back to the start, -1 if not possible (pipe) */
+    void (*close)(capture *c);
+    void *src;                                    /* Source state */
+    char desc[80];
+
+    /* Delivery, set by captureStart */
+    int N;
+    int fs;
+    int fast;
+    int loop;                                     /* Restart the source at its end */
+    rtNotify *ack;                                /* fast: published once a block is consumed */
+    int prime;                                    /* fast: blocks delivered before the first wait */
+    captureCallback callback;
+    void *userdata;
+    void (*onEnd)(void);                          /* Source ended (feeder thread) */
+    pthread_t thread;
+    atomic_int running;
+    int started;
+    uint64_t blocks;                              /* Blocks delivered */
+    uint64_t ackTimeouts;                         /* fast: CAPTURE_ACK_TIMEOUT_MS waits */
+    struct timespec t0, t1;                       /* First / last delivery */
+};
+
+/* *******************************************************************
+ * Opens a source
+ * Args are:
+ * 		capture *c: capture (zeroed by captureOpen)
+ * 		const char *spec: source, see above
+ * 		int fs: capture rate (files at another rate are refused)
+ * Returns 0, or -1 (message on stderr)
+ * *******************************************************************/
+int captureOpen(capture *c, const char *spec, int fs);
+
+/* *******************************************************************
+ * Starts the feeder thread
+ * Args are:
+ * 		int N: samples per block (<= CAPTURE_MAX_BLOCK)
+ * 		int fast: 0: real-time pacing, 1: paced by ack
+ * 		int loop: restart the source at its end (not possible on pipes)
+ * 		rtNotify *ack: consumer notification (fast mode)
+ * 		int prime: fast mode, blocks delivered before the first wait (>= 1)
+ * 		captureCallback callback, void *userdata: receives each block
+ * 		void (*onEnd)(void): called once when the source ends (NULL: none)
+ * Returns 0, or -1 if the thread cannot be created
+ * *******************************************************************/
+int captureStart(capture *c, int N, int fast, int loop, rtNotify *ack, int prime,
+                 captureCallback callback, void *userdata, void (*onEnd)(void));
+
+/* *******************************************************************
+ * Stops the feeder (after its current block) and closes the source
+ * *******************************************************************/
+void captureStop(capture *c);
+
+/* *******************************************************************
+ * Prints the blocks delivered and the rate relative to real time
+ * *******************************************************************/
+void captureReport(FILE *f, const capture *c);
+
+/* Samples of a WAV file (16-bit PCM, interleaved channels) */
+typedef struct {
+    long dataStart;                               /* File offset */
+    uint64_t dataSize;                            /* Bytes */
+    int channels;
+} captureWavLayout;
+
+/* *******************************************************************
+ * Reads the header of a WAV file, from its start, up to its samples
+ * Args are:
+ * 		FILE *f: file, at offset 0; left at the first sample
+ * 		const char *path: for the messages
+ * 		int fs: required rate
+ * 		captureWavLayout *w: output (dataSize: at most what the file
+ *                    holds after dataStart, with a warning if the header
+ *                    claims more)
+ * Returns 0, or -1 (message on stderr) if it is not a 16-bit PCM
+ * file at fs Hz
+ * *******************************************************************/
+int captureWavParse(FILE *f, const char *path, int fs, captureWavLayout *w);
+
+/* Sources (capture/sources.c) */
+int captureOpenWav(capture *c, const char *path, int fs);
+int captureOpenRaw(capture *c, const char *path);
+int captureOpenGen(capture *c, int scenario, double seconds, int fs);
+
+#endif
@@ -0,0 +1,289 @@
+/* ************************************************************
+ * Headless capture sources: WAV file, raw PCM (file or stdin) and
+ * the signalgen test scenarios generated in process
+ * ************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sys/stat.h>
+#include "capture.h"
+
+#define SRC_CHUNK 1024              /* Frames converted per fread */
+
+/* Signed 16-bit little-endian to the unsigned samples SDL delivers */
+static uint16_t s16leToU16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8)) ^ 0x8000;
+}
+
+static uint32_t le32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/* ************************************************************
+ * File sources (WAV and raw share the reader)
+ * ************************************************************/
+
+typedef struct {
+    FILE *f;
+    int channels;                   /* Interleaved, the first one is used */
+    long dataStart;                 /* File offset of the samples */
+    uint64_t dataLeft;              /* Bytes left (raw: unbounded) */
+    uint64_t dataSize;
+    uint8_t chunk[SRC_CHUNK * 2 * 8];
+} fileSource;
+
+static int fileRead(capture *c, uint16_t *x, int n) {
+    fileSource *s = c->src;
+    const int frame = 2 * s->channels;
+    int got = 0;
+
+    while (got < n) {
+        size_t want = (size_t)(n - got);
+        if (want > SRC_CHUNK) want = SRC_CHUNK;
+        if (want * frame > s->dataLeft) want = s->dataLeft / frame;
+        if (want == 0) break;
+
+        size_t r = fread(s->chunk, frame, want, s->f);
+        for (size_t i = 0; i < r; i++) {
+            x[got + i] = s16leToU16(s->chunk + i * frame);
+        }
+        got += (int)r;
+        s->dataLeft -= r * frame;
+        if (r < want) {
+            if (ferror(s->f) && got == 0) return -1;
+            s->dataLeft = 0;
+            break;
+        }
+    }
+    return got;
+}
+
+static int fileRewind(capture *c) {
+    fileSource *s = c->src;
+
+    if (fseek(s->f, s->dataStart, SEEK_SET) != 0) return -1;
+    s->dataLeft = s->dataSize;
+    return 0;
+}
+
+static void fileClose(capture *c) {
+    fileSource *s = c->src;
+
+    if (s->f != stdin) fclose(s->f);
+    free(s);
+    c->src = NULL;
+}
+
+static fileSource *fileOpen(capture *c, const char *path) {
+    fileSource *s = calloc(1, sizeof(fileSource));
+    if (s == NULL) return NULL;
+
+    s->f = (strcmp(path, "-") == 0) ? stdin : fopen(path, "rb");
+    if (s->f == NULL) {
+        perror(path);
+        free(s);
+        return NULL;
+    }
+    s->channels = 1;
+    c->src = s;
+    c->read = fileRead;
+    c->rewind = fileRewind;
+    c->close = fileClose;
+    return s;
+}
+
+int captureWavParse(FILE *f, const char *path, int fs, captureWavLayout *w) {
+    uint8_t hdr[12], chunk[8], fmt[16];
+    int haveFmt = 0;
+
+    if (fread(hdr, 1, 12, f) != 12 || memcmp(hdr, "RIFF", 4) != 0 || memcmp(hdr + 8, "WAVE", 4) != 0) {
+        fprintf(stderr, "%s: not a RIFF/WAVE file\n", path);
+        return -1;
+    }
+
+    /* Chunks until "data"; "fmt " must come before it */
+    while (fread(chunk, 1, 8, f) == 8) {
+        uint32_t size = le32(chunk + 4);
+
+        if (memcmp(chunk, "fmt ", 4) == 0 && size >= 16) {
+            if (fread(fmt, 1, 16, f) != 16) break;
+            if (fseek(f, (long)(size - 16 + (size & 1)), SEEK_CUR) != 0) break;
+            haveFmt = 1;
+        } else if (memcmp(chunk, "data", 4) == 0) {
+            int format = fmt[0] | (fmt[1] << 8);
+            int channels = fmt[2] | (fmt[3] << 8);
+            uint32_t rate = le32(fmt + 4);
+            int bits = fmt[14] | (fmt[15] << 8);
+
+            if (!haveFmt || format != 1 || bits != 16 || channels < 1 || channels > 8) {
+                fprintf(stderr, "%s: only 16-bit PCM WAV files are supported\n", path);
+                return -1;
+            }
+            if (rate != (uint32_t)fs) {
+                fprintf(stderr, "%s: %u Hz, the capture rate is %d Hz\n", path, rate, fs);
+                return -1;
+            }
+            w->channels = channels;
+            w->dataStart = ftell(f);
+            w->dataSize = size;
+
+            /* Truncated recording, or header never finalized: the data
+             * chunk claims more than the file holds */
+            struct stat st;
+            if (fstat(fileno(f), &st) == 0 && S_ISREG(st.st_mode)
+                && (uint64_t)st.st_size < w->dataStart + w->dataSize) {
+                uint64_t left = ((uint64_t)st.st_size > (uint64_t)w->dataStart) ? st.st_size - w->dataStart : 0;
+                fprintf(stderr, "%s: data chunk of %llu bytes, only %llu in the file (truncated?): using those\n",
+                        path, (unsigned long long)w->dataSize, (unsigned long long)left);
+                w->dataSize = left;
+            }
+            return 0;
+        } else if (fseek(f, (long)(size + (size & 1)), SEEK_CUR) != 0) {
+            break;
+        }
+    }
+
+    fprintf(stderr, "%s: no PCM data found\n", path);
+    return -1;
+}
+
+int captureOpenWav(capture *c, const char *path, int fs) {
+    captureWavLayout w;
+
+    fileSource *s = fileOpen(c, path);
+    if (s == NULL) return -1;
+
+    if (captureWavParse(s->f, path, fs, &w) != 0) {
+        fileClose(c);
+        return -1;
+    }
+    s->channels = w.channels;
+    s->dataStart = w.dataStart;
+    s->dataSize = s->dataLeft = w.dataSize;
+    snprintf(c->desc, sizeof(c->desc), "wav:%s (%.1f s, %d ch)",
+             path, (double)w.dataSize / (2.0 * w.channels * fs), w.channels);
+    return 0;
+}
+
+int captureOpenRaw(capture *c, const char *path) {
+    fileSource *s = fileOpen(c, path);
+    if (s == NULL) return -1;
+
+    s->dataStart = 0;
+    s->dataSize = s->dataLeft = UINT64_MAX;
+    snprintf(c->desc, sizeof(c->desc), "raw:%s", path);
+    return 0;
+}
+
+/* ************************************************************
+ * Test scenarios of signalgen, generated block by block with
+ * continuous phase (so they can be looped and run for any length)
+ * ************************************************************/
+
+#define GEN_TONES 3
+
+typedef struct {
+    int scenario;
+    int fs;
+    uint64_t n;                     /* Next sample */
+    uint64_t total;                 /* Samples to generate */
+    double length;                  /* Scenario length, s */
+    double phase[GEN_TONES];
+} genSource;
+
+static const double genLength[] = { 10.0, 8.0, 8.0, 10.0, 10.0, 10.0 };
+
+/* Frequencies (Hz) and amplitudes (peak to peak) of the tones at time t */
+static void genTones(int scenario, double t, double length, double f[GEN_TONES], double a[GEN_TONES]) {
+    for (int k = 0; k < GEN_TONES; k++) f[k] = a[k] = 0.0;
+
+    switch (scenario) {
+    case 0:     /* Constant speed, 300 Hz */
+        f[0] = 300.0; a[0] = 30000;
+        break;
+    case 1:     /* Acceleration, 300 -> 500 Hz */
+        f[0] = 300.0 + 200.0 * t / length; a[0] = 30000;
+        break;
+    case 2:     /* Deceleration, 500 -> 300 Hz */
+        f[0] = 500.0 - 200.0 * t / length; a[0] = 30000;
+        break;
+    case 3:     /* 420 Hz with 3 kHz bursts (bearing fault), 100 ms on/off */
+        f[0] = 420.0; a[0] = 30000;
+        f[1] = 3000.0; a[1] = (fmod(t, 0.2) < 0.1) ? 12000 : 0;
+        break;
+    case 4:     /* Start, 150 Hz run and stop */
+        a[0] = 30000;
+        if (t < 1.0)      a[0] = 0;
+        else if (t < 3.0) f[0] = 150.0 * (t - 1.0) / 2.0;
+        else if (t < 6.0) f[0] = 150.0;
+        else if (t < 8.0) f[0] = 150.0 * (8.0 - t) / 2.0;
+        else              a[0] = 0;
+        break;
+    case 5:     /* Harmonics, 80 + 160 + 240 Hz */
+        f[0] = 80.0;  a[0] = 20000;
+        f[1] = 160.0; a[1] = 15000;
+        f[2] = 240.0; a[2] = 10000;
+        break;
+    }
+}
+
+static int genRead(capture *c, uint16_t *x, int n) {
+    genSource *g = c->src;
+    double f[GEN_TONES], a[GEN_TONES];
+    int i;
+
+    for (i = 0; i < n && g->n < g->total; i++, g->n++) {
+        double t = fmod((double)g->n / g->fs, g->length);
+        double v = 0.0;
+
+        genTones(g->scenario, t, g->length, f, a);
+        for (int k = 0; k < GEN_TONES; k++) {
+            g->phase[k] += 2.0 * M_PI * f[k] / g->fs;
+            if (g->phase[k] > 2.0 * M_PI) g->phase[k] -= 2.0 * M_PI;
+            v += a[k] / 2.0 * sin(g->phase[k]);
+        }
+        if (v > 32767.0) v = 32767.0;
+        if (v < -32768.0) v = -32768.0;
+        x[i] = (uint16_t)(32768 + (int)v);
+    }
+    return i;
+}
+
+static int genRewind(capture *c) {
+    genSource *g = c->src;
+
+    g->n = 0;
+    for (int k = 0; k < GEN_TONES; k++) g->phase[k] = 0.0;
+    return 0;
+}
+
+static void genClose(capture *c) {
+    free(c->src);
+    c->src = NULL;
+}
+
+int captureOpenGen(capture *c, int scenario, double seconds, int fs) {
+    int nScenarios = (int)(sizeof(genLength) / sizeof(genLength[0]));
+
+    if (scenario < 0 || scenario >= nScenarios) {
+        fprintf(stderr, "Capture: scenario %d, valid ones are 0 .. %d\n", scenario, nScenarios - 1);
+        return -1;
+    }
+    genSource *g = calloc(1, sizeof(genSource));
+    if (g == NULL) return -1;
+
+    g->scenario = scenario;
+    g->fs = fs;
+    g->length = genLength[scenario];
+    if (seconds <= 0.0) seconds = g->length;
+    g->total = (uint64_t)(seconds * fs);
+
+    c->src = g;
+    c->read = genRead;
+    c->rewind = genRewind;
+    c->close = genClose;
+    snprintf(c->desc, sizeof(c->desc), "gen:%d (%.1f s)", scenario, seconds);
+    return 0;
+}
@@ -0,0 +1,80 @@
+/* ************************************************************
+ * Band-limited DFT: bank of Goertzel filters
+ * ************************************************************/
+
+#include <stddef.h>
+#include <math.h>
+#include "goertzel.h"
+#include "kernels.h"
+
+int goertzelInit(goertzelBank *g, const goertzelBandConfig *bands, int nbands, int N, double fs) {
+
+    if (N <= 0 || nbands < 1 || nbands > GOERTZEL_MAX_BANDS) return -1;
+
+    g->N = N;
+    g->nbins = 0;
+    g->nbands = nbands;
+    for (int b = 0; b < nbands; b++) {
+        if (bands[b].f0 <= 0.0 || bands[b].f1 > fs / 2 || bands[b].f1 < bands[b].f0) return -1;
+
+        int k0 = (int)ceil(bands[b].f0 * N / fs);
+        int k1 = (int)floor(bands[b].f1 * N / fs);
+        if (k1 < k0 || g->nbins + (k1 - k0 + 1) > GOERTZEL_MAX_BINS) return -1;
+
+        g->bandFirst[b] = g->nbins;
+        g->bandBins[b] = k1 - k0 + 1;
+        for (int k = k0; k <= k1; k++, g->nbins++) {
+            g->coef[g->nbins] = 2.0 * cos(2.0 * M_PI * k / N);
+            g->freq[g->nbins] = (float)(k * fs / N);
+            g->Ak[g->nbins] = 0.0f;
+        }
+    }
+    g->blocks = 0;
+    goertzelReset(g);
+    return 0;
+}
+
+void goertzelReset(goertzelBank *g) {
+    for (int j = 0; j < g->nbins; j++) {
+        g->s1[j] = 0.0;
+        g->s2[j] = 0.0;
+    }
+    g->count = 0;
+}
+
+int goertzelPushU16(goertzelBank *g, const uint16_t *x, int n, double offset) {
+    int done = 0;
+
+    while (n > 0) {
+        int m = (g->N - g->count < n) ? g->N - g->count : n;
+
+        kGoertzelU16(x, m, offset, g->coef, g->s1, g->s2, g->nbins);
+        x += m;
+        n -= m;
+        g->count += m;
+
+        if (g->count == g->N) {
+            /* |X[k]|^2 = s1^2 + s2^2 - coef*s1*s2 */
+            const double *s1 = g->s1, *s2 = g->s2, *coef = g->coef;
+            double scale = 2.0 / g->N;
+            for (int j = 0; j < g->nbins; j++) {
+                double p = s1[j] * s1[j] + s2[j] * s2[j] - coef[j] * s1[j] * s2[j];
+                g->Ak[j] = (float)(scale * sqrt(p > 0.0 ? p : 0.0));
+            }
+            g->blocks++;
+            goertzelReset(g);
+            done++;
+        }
+    }
+    return done;
+}
+
+float goertzelBandMax(const goertzelBank *g, int band, float *freq) {
+    int first = g->bandFirst[band], best = first;
+
+    for (int j = first + 1; j < first + g->bandBins[band]; j++) {
+        if (g->Ak[j] > g->Ak[best]) best = j;
+    }
+    if (freq != NULL) *freq = g->freq[best];
+    return g->Ak[best];
+}
@@ -0,0 +1,90 @@
+/* ************************************************************
+ * Band-limited DFT: bank of Goertzel filters
+ *
+ * Computes the amplitude of a configured set of DFT bins only, instead
+ * of the whole spectrum: the bins of a few frequency bands, at the
+ * resolution fs/N of an N-sample block. Each bin costs one multiply
+ * and two adds per sample, so a bank of B bins is cheaper than an FFT
+ * while B is small compared to log2(N) * (FFT cost per point). The
+ * recurrence runs in kGoertzelU16 (several bins per SSE2/AVX2 vector).
+ *
+ * Samples can be pushed one block at a time or in pieces of any size
+ * (e.g. as they arrive): the filter state is kept in the bank and the
+ * amplitudes are updated each time N samples have been accumulated.
+ * No allocation: the bank can be static or on the stack.
+ *
+ * Not used by the real-time tasks: rtsounds computes the full
+ * spectrum of each block once (Preprocessing) for Speed and FFT, so
+ * the Issue decision on it is two band scans, while a bank covering
+ * its bands up to fs/2 costs as much as the FFT or more, and a
+ * narrower bank misses the faults above it (bench/goertzel_bench).
+ * A bank pays off where no spectrum is computed anyway and only a few
+ * narrow bands are watched.
+ * ************************************************************/
+
+#ifndef _GOERTZEL_H
+#define _GOERTZEL_H
+
+#include <stdint.h>
+
+#define GOERTZEL_MAX_BINS 512
+#define GOERTZEL_MAX_BANDS 8
+
+/* One band: all the bins k*fs/N with f0 <= k*fs/N <= f1 */
+typedef struct {
+    double f0;      /* Lower edge (Hz) */
+    double f1;      /* Upper edge (Hz) */
+} goertzelBandConfig;
+
+typedef struct {
+    int N;                              /* Block length (samples) */
+    int nbins;
+    double coef[GOERTZEL_MAX_BINS];     /* 2*cos(2*pi*k/N) */
+    double s1[GOERTZEL_MAX_BINS];       /* Filter state */
+    double s2[GOERTZEL_MAX_BINS];
+    float freq[GOERTZEL_MAX_BINS];      /* Frequency of each bin (Hz) */
+    float Ak[GOERTZEL_MAX_BINS];        /* Amplitudes of the last complete block */
+    int count;                          /* Samples accumulated in the current block */
+    uint32_t blocks;                    /* Blocks completed so far */
+    int nbands;
+    int bandFirst[GOERTZEL_MAX_BANDS];  /* First bin of each band */
+    int bandBins[GOERTZEL_MAX_BANDS];   /* Number of bins of each band */
+} goertzelBank;
+
+/* *******************************************************************
+ * Initializes a bank for the bins of nbands bands
+ * Args are:
+ * 		goertzelBank *g: the bank
+ * 		const goertzelBandConfig *bands: band edges
+ * 		int nbands: number of bands (1 .. GOERTZEL_MAX_BANDS)
+ * 		int N: block length (any N > 0, not only powers of 2)
+ * 		double fs: sampling frequency (in Hz)
+ * Returns 0, or -1 if a band is empty or outside ]0, fs/2], or if the
+ * bands have more than GOERTZEL_MAX_BINS bins in total
+ * *******************************************************************/
+int goertzelInit(goertzelBank *g, const goertzelBandConfig *bands, int nbands, int N, double fs);
+
+/* *******************************************************************
+ * Discards the samples of the current (incomplete) block
+ * *******************************************************************/
+void goertzelReset(goertzelBank *g);
+
+/* *******************************************************************
+ * Feeds n raw 16-bit samples, minus offset, to all the bins
+ * Each time N samples are accumulated, Ak is updated (scaled by 2/N,
+ * as fftGetAmplitude does) and a new block starts
+ * Returns the number of blocks completed during the call
+ * *******************************************************************/
+int goertzelPushU16(goertzelBank *g, const uint16_t *x, int n, double offset);
+
+/* *******************************************************************
+ * Largest amplitude of a band in the last complete block
+ * Args are:
+ * 		const goertzelBank *g: the bank
+ * 		int band: band index (order of goertzelInit)
+ * 		float *freq: if not NULL, receives the frequency of that bin
+ * Returns the amplitude
+ * *******************************************************************/
+float goertzelBandMax(const goertzelBank *g, int band, float *freq);
+
+#endif
@@ -0,0 +1,78 @@
+/* ************************************************************
+ * Streaming IIR filters: cascade of biquad sections
+ * ************************************************************/
+
+#include <math.h>
+#include "iir.h"
+
+int biquadDesign(biquad *bq, const biquadConfig *cfg, double fs) {
+
+    if (cfg->f0 <= 0.0 || cfg->f0 >= fs / 2 || cfg->Q <= 0.0) return -1;
+
+    double w0 = 2.0 * M_PI * cfg->f0 / fs;
+    double cosw = cos(w0);
+    double alpha = sin(w0) / (2.0 * cfg->Q);
+    double b0, b1, b2;
+    double a0 = 1.0 + alpha, a1 = -2.0 * cosw, a2 = 1.0 - alpha;
+
+    switch (cfg->type) {
+    case BIQUAD_LP:
+        b0 = (1.0 - cosw) / 2.0; b1 = 1.0 - cosw; b2 = b0;
+        break;
+    case BIQUAD_HP:
+        b0 = (1.0 + cosw) / 2.0; b1 = -(1.0 + cosw); b2 = b0;
+        break;
+    case BIQUAD_BP:
+        b0 = alpha; b1 = 0.0; b2 = -alpha;
+        break;
+    case BIQUAD_NOTCH:
+        b0 = 1.0; b1 = -2.0 * cosw; b2 = 1.0;
+        break;
+    default:
+        return -1;
+    }
+
+    bq->b0 = b0 / a0;
+    bq->b1 = b1 / a0;
+    bq->b2 = b2 / a0;
+    bq->a1 = a1 / a0;
+    bq->a2 = a2 / a0;
+    bq->z1 = bq->z2 = 0.0;
+    return 0;
+}
+
+int iirInit(iirFilter *f, const biquadConfig *cfg, int nstages, double fs) {
+
+    if (nstages < 0 || nstages > IIR_MAX_STAGES) return -1;
+
+    f->nstages = nstages;
+    for (int s = 0; s < nstages; s++) {
+        if (biquadDesign(&f->stage[s], &cfg[s], fs) != 0) return -1;
+    }
+    return 0;
+}
+
+void iirReset(iirFilter *f) {
+    for (int s = 0; s < f->nstages; s++) {
+        f->stage[s].z1 = f->stage[s].z2 = 0.0;
+    }
+}
+
+/* One sample through one section (transposed direct form II) */
+static inline double biquadStep(biquad *bq, double x) {
+    double y = bq->b0 * x + bq->z1;
+    bq->z1 = bq->b1 * x - bq->a1 * y + bq->z2;
+    bq->z2 = bq->b2 * x - bq->a2 * y;
+    return y;
+}
+
+void iirProcessU16(iirFilter *f, const uint16_t *in, uint16_t *out, int n, double offset) {
+    for (int i = 0; i < n; i++) {
+        double y = (double)in[i] - offset;
+        for (int s = 0; s < f->nstages; s++) {
+            y = biquadStep(&f->stage[s], y);
+        }
+        y = lrint(y + offset);
+        out[i] = (y < 0.0) ? 0 : (y > 65535.0) ? 65535 : (uint16_t)y;
+    }
+}
@@ -0,0 +1,76 @@
+/* ************************************************************
+ * Streaming IIR filters: cascade of biquad sections
+ *
+ * Each section is designed from the RBJ "Audio EQ Cookbook" formulas
+ * and runs in transposed direct form II. The state of every section
+ * is kept in the filter object, so consecutive blocks are filtered
+ * as one continuous stream (no discontinuity at block boundaries).
+ * No allocation: the filter object can be static or on the stack.
+ * ************************************************************/
+
+#ifndef _IIR_H
+#define _IIR_H
+
+#include <stdint.h>
+
+#define IIR_MAX_STAGES 8
+
+typedef enum {
+    BIQUAD_LP,      /* Low-pass, cut-off f0 */
+    BIQUAD_HP,      /* High-pass, cut-off f0 */
+    BIQUAD_BP,      /* Band-pass, centre f0, 0 dB peak gain */
+    BIQUAD_NOTCH    /* Notch (band-stop), centre f0 */
+} biquadType;
+
+/* Design parameters of one section */
+typedef struct {
+    biquadType type;
+    double f0;      /* Cut-off / centre frequency (Hz) */
+    double Q;       /* Quality factor (0.707: Butterworth LP/HP) */
+} biquadConfig;
+
+/* One section: normalized coefficients (a0 = 1) and state */
+typedef struct {
+    double b0, b1, b2, a1, a2;
+    double z1, z2;
+} biquad;
+
+typedef struct {
+    biquad stage[IIR_MAX_STAGES];
+    int nstages;
+} iirFilter;
+
+/* *******************************************************************
+ * Computes the coefficients of one section (state is cleared)
+ * Args are:
+ * 		biquad *bq: section
+ * 		const biquadConfig *cfg: type, f0, Q
+ * 		double fs: sampling frequency (in Hz)
+ * Returns 0, or -1 if f0 is not in ]0, fs/2[ or Q <= 0
+ * *******************************************************************/
+int biquadDesign(biquad *bq, const biquadConfig *cfg, double fs);
+
+/* *******************************************************************
+ * Initializes a cascade of nstages sections
+ * Returns 0, or -1 if nstages > IIR_MAX_STAGES or a section is invalid
+ * *******************************************************************/
+int iirInit(iirFilter *f, const biquadConfig *cfg, int nstages, double fs);
+
+/* *******************************************************************
+ * Clears the state of all sections (e.g. after a gap in the stream)
+ * *******************************************************************/
+void iirReset(iirFilter *f);
+
+/* *******************************************************************
+ * Filters n unsigned 16-bit samples (e.g. AUDIO_U16)
+ * Args are:
+ * 		const uint16_t *in: input samples
+ * 		uint16_t *out: output samples (may be the same array as in)
+ * 		int n: number of samples
+ * 		double offset: DC offset of the samples (32768.0 for U16 audio);
+ *                    the filter runs on (in - offset), the output is
+ *                    shifted back and saturated to 0 .. 65535
+ * *******************************************************************/
+void iirProcessU16(iirFilter *f, const uint16_t *in, uint16_t *out, int n, double offset);
+
+#endif
@@ -0,0 +1,473 @@
+/* ************************************************************
+ * Vectorized kernels for the loops around the FFT
+ *
+ * The SSE2/AVX2 versions are compiled with target attributes, so the
+ * module builds with the default flags and the CPU is only checked at
+ * run time (kernelsInit). Tails shorter than a vector use the scalar
+ * code.
+ * ************************************************************/
+
+#include <math.h>
+#include "kernels.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define KERNELS_X86
+#include <immintrin.h>
+#endif
+
+/* ***********************************************
+ * Scalar versions (reference)
+ * ***********************************************/
+static void convertCenterU16Scalar(const uint16_t *in, double offset, double *out, int n) {
+    for (int i = 0; i < n; i++) {
+        out[i] = (double)in[i] - offset;
+    }
+}
+
+static void applyWindowScalar(const float *in, const float *w, float *out, int n) {
+    for (int i = 0; i < n; i++) {
+        out[i] = in[i] * w[i];
+    }
+}
+
+static void amplitudeScalar(const complex double *X, float *out, int n, double scale) {
+    const double *x = (const double *)X;
+    for (int k = 0; k < n; k++) {
+        out[k] = scale * sqrt(x[2 * k] * x[2 * k] + x[2 * k + 1] * x[2 * k + 1]);
+    }
+}
+
+static void convertCenterU16FScalar(const uint16_t *in, float offset, float *out, int n) {
+    for (int i = 0; i < n; i++) {
+        out[i] = (float)in[i] - offset;
+    }
+}
+
+static void amplitudeFScalar(const complex float *X, float *out, int n, float scale) {
+    const float *x = (const float *)X;
+    for (int k = 0; k < n; k++) {
+        out[k] = scale * sqrtf(x[2 * k] * x[2 * k] + x[2 * k + 1] * x[2 * k + 1]);
+    }
+}
+
+/* Goertzel recurrence, 4 bins at a time (independent chains) */
+static void goertzelU16Scalar(const uint16_t *x, int n, double offset, const double *coef,
+                              double *s1, double *s2, int nbins) {
+    int j = 0;
+    for (; j + 4 <= nbins; j += 4) {
+        double c0 = coef[j], c1 = coef[j + 1], c2 = coef[j + 2], c3 = coef[j + 3];
+        double a0 = s1[j], a1 = s1[j + 1], a2 = s1[j + 2], a3 = s1[j + 3];
+        double b0 = s2[j], b1 = s2[j + 1], b2 = s2[j + 2], b3 = s2[j + 3];
+        for (int i = 0; i < n; i++) {
+            double v = (double)x[i] - offset, t;
+            t = v + c0 * a0 - b0; b0 = a0; a0 = t;
+            t = v + c1 * a1 - b1; b1 = a1; a1 = t;
+            t = v + c2 * a2 - b2; b2 = a2; a2 = t;
+            t = v + c3 * a3 - b3; b3 = a3; a3 = t;
+        }
+        s1[j] = a0; s1[j + 1] = a1; s1[j + 2] = a2; s1[j + 3] = a3;
+        s2[j] = b0; s2[j + 1] = b1; s2[j + 2] = b2; s2[j + 3] = b3;
+    }
+    for (; j < nbins; j++) {
+        double c = coef[j], a = s1[j], b = s2[j];
+        for (int i = 0; i < n; i++) {
+            double t = (double)x[i] - offset + c * a - b;
+            b = a;
+            a = t;
+        }
+        s1[j] = a;
+        s2[j] = b;
+    }
+}
+
+static int argmaxBandScalar(const float *A, int kmin, int kmax) {
+    int maxIdx = kmin;
+    for (int k = kmin + 1; k <= kmax; k++) {
+        if (A[k] > A[maxIdx]) maxIdx = k;
+    }
+    return maxIdx;
+}
+
+#ifdef KERNELS_X86
+/* ***********************************************
+ * SSE2 versions
+ * ***********************************************/
+__attribute__((target("sse2")))
+static void convertCenterU16Sse2(const uint16_t *in, double offset, double *out, int n) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128d off = _mm_set1_pd(offset);
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i *)&in[i]);
+        __m128i lo = _mm_unpacklo_epi16(v, zero);     // 4 x int32
+        __m128i hi = _mm_unpackhi_epi16(v, zero);
+        _mm_storeu_pd(&out[i],     _mm_sub_pd(_mm_cvtepi32_pd(lo), off));
+        _mm_storeu_pd(&out[i + 2], _mm_sub_pd(_mm_cvtepi32_pd(_mm_srli_si128(lo, 8)), off));
+        _mm_storeu_pd(&out[i + 4], _mm_sub_pd(_mm_cvtepi32_pd(hi), off));
+        _mm_storeu_pd(&out[i + 6], _mm_sub_pd(_mm_cvtepi32_pd(_mm_srli_si128(hi, 8)), off));
+    }
+    convertCenterU16Scalar(&in[i], offset, &out[i], n - i);
+}
+
+__attribute__((target("sse2")))
+static void applyWindowSse2(const float *in, const float *w, float *out, int n) {
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm_storeu_ps(&out[i], _mm_mul_ps(_mm_loadu_ps(&in[i]), _mm_loadu_ps(&w[i])));
+    }
+    applyWindowScalar(&in[i], &w[i], &out[i], n - i);
+}
+
+/* |X[k]|^2 and |X[k+1]|^2 as one vector */
+__attribute__((target("sse2")))
+static inline __m128d squaredMagnitude2(const double *x) {
+    __m128d a = _mm_loadu_pd(x);          // re0 im0
+    __m128d b = _mm_loadu_pd(x + 2);      // re1 im1
+    a = _mm_mul_pd(a, a);
+    b = _mm_mul_pd(b, b);
+    return _mm_add_pd(_mm_unpacklo_pd(a, b), _mm_unpackhi_pd(a, b));
+}
+
+__attribute__((target("sse2")))
+static void amplitudeSse2(const complex double *X, float *out, int n, double scale) {
+    const double *x = (const double *)X;
+    const __m128d s = _mm_set1_pd(scale);
+    int k = 0;
+    for (; k + 2 <= n; k += 2) {
+        __m128d m = _mm_mul_pd(s, _mm_sqrt_pd(squaredMagnitude2(&x[2 * k])));
+        _mm_storel_pi((__m64 *)&out[k], _mm_cvtpd_ps(m));
+    }
+    amplitudeScalar(&X[k], &out[k], n - k, scale);
+}
+
+__attribute__((target("sse2")))
+static void convertCenterU16FSse2(const uint16_t *in, float offset, float *out, int n) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 off = _mm_set1_ps(offset);
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i *)&in[i]);
+        _mm_storeu_ps(&out[i],     _mm_sub_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(v, zero)), off));
+        _mm_storeu_ps(&out[i + 4], _mm_sub_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(v, zero)), off));
+    }
+    convertCenterU16FScalar(&in[i], offset, &out[i], n - i);
+}
+
+__attribute__((target("sse2")))
+static void amplitudeFSse2(const complex float *X, float *out, int n, float scale) {
+    const float *x = (const float *)X;
+    const __m128 s = _mm_set1_ps(scale);
+    int k = 0;
+    for (; k + 4 <= n; k += 4) {
+        __m128 a = _mm_loadu_ps(&x[2 * k]);         // re0 im0 re1 im1
+        __m128 b = _mm_loadu_ps(&x[2 * k + 4]);     // re2 im2 re3 im3
+        a = _mm_mul_ps(a, a);
+        b = _mm_mul_ps(b, b);
+        __m128 m = _mm_add_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)),
+                              _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+        _mm_storeu_ps(&out[k], _mm_mul_ps(s, _mm_sqrt_ps(m)));
+    }
+    amplitudeFScalar(&X[k], &out[k], n - k, scale);
+}
+
+__attribute__((target("sse2")))
+static int argmaxBandSse2(const float *A, int kmin, int kmax) {
+    int n = kmax - kmin + 1;
+    if (n < 8) return argmaxBandScalar(A, kmin, kmax);
+
+    // Each lane keeps its first maximum (strict >)
+    __m128 maxV = _mm_loadu_ps(&A[kmin]);
+    __m128i maxI = _mm_add_epi32(_mm_set1_epi32(kmin), _mm_setr_epi32(0, 1, 2, 3));
+    __m128i idx = maxI;
+    const __m128i four = _mm_set1_epi32(4);
+    int k = kmin + 4;
+
+    for (; k + 4 <= kmax + 1; k += 4) {
+        idx = _mm_add_epi32(idx, four);
+        __m128 v = _mm_loadu_ps(&A[k]);
+        __m128 gt = _mm_cmpgt_ps(v, maxV);
+        maxV = _mm_or_ps(_mm_and_ps(gt, v), _mm_andnot_ps(gt, maxV));
+        __m128i gti = _mm_castps_si128(gt);
+        maxI = _mm_or_si128(_mm_and_si128(gti, idx), _mm_andnot_si128(gti, maxI));
+    }
+
+    float vals[4];
+    int idxs[4];
+    _mm_storeu_ps(vals, maxV);
+    _mm_storeu_si128((__m128i *)idxs, maxI);
+
+    // Lanes: largest value, lowest index on ties
+    int best = idxs[0];
+    float bestV = vals[0];
+    for (int l = 1; l < 4; l++) {
+        if (vals[l] > bestV || (vals[l] == bestV && idxs[l] < best)) {
+            bestV = vals[l];
+            best = idxs[l];
+        }
+    }
+    for (; k <= kmax; k++) {
+        if (A[k] > bestV) {
+            bestV = A[k];
+            best = k;
+        }
+    }
+    return best;
+}
+
+/* Goertzel recurrence, 8 bins at a time (4 vectors of 2) */
+__attribute__((target("sse2")))
+static void goertzelU16Sse2(const uint16_t *x, int n, double offset, const double *coef,
+                            double *s1, double *s2, int nbins) {
+    int j = 0;
+    for (; j + 8 <= nbins; j += 8) {
+        __m128d c[4], a[4], b[4];
+        for (int l = 0; l < 4; l++) {
+            c[l] = _mm_loadu_pd(&coef[j + 2 * l]);
+            a[l] = _mm_loadu_pd(&s1[j + 2 * l]);
+            b[l] = _mm_loadu_pd(&s2[j + 2 * l]);
+        }
+        for (int i = 0; i < n; i++) {
+            __m128d v = _mm_set1_pd((double)x[i] - offset);
+            for (int l = 0; l < 4; l++) {
+                __m128d t = _mm_add_pd(_mm_sub_pd(v, b[l]), _mm_mul_pd(c[l], a[l]));
+                b[l] = a[l];
+                a[l] = t;
+            }
+        }
+        for (int l = 0; l < 4; l++) {
+            _mm_storeu_pd(&s1[j + 2 * l], a[l]);
+            _mm_storeu_pd(&s2[j + 2 * l], b[l]);
+        }
+    }
+    goertzelU16Scalar(x, n, offset, &coef[j], &s1[j], &s2[j], nbins - j);
+}
+
+/* ***********************************************
+ * AVX2 versions
+ * ***********************************************/
+__attribute__((target("avx2")))
+static void convertCenterU16Avx2(const uint16_t *in, double offset, double *out, int n) {
+    const __m256d off = _mm256_set1_pd(offset);
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m256i v = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)&in[i]));
+        _mm256_storeu_pd(&out[i],     _mm256_sub_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(v)), off));
+        _mm256_storeu_pd(&out[i + 4], _mm256_sub_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(v, 1)), off));
+    }
+    convertCenterU16Scalar(&in[i], offset, &out[i], n - i);
+}
+
+__attribute__((target("avx2")))
+static void applyWindowAvx2(const float *in, const float *w, float *out, int n) {
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(&out[i], _mm256_mul_ps(_mm256_loadu_ps(&in[i]), _mm256_loadu_ps(&w[i])));
+    }
+    applyWindowScalar(&in[i], &w[i], &out[i], n - i);
+}
+
+/* |X[k]|^2 .. |X[k+3]|^2 as one vector */
+__attribute__((target("avx2")))
+static inline __m256d squaredMagnitude4(const double *x) {
+    __m256d a = _mm256_loadu_pd(x);       // re0 im0 re1 im1
+    __m256d b = _mm256_loadu_pd(x + 4);   // re2 im2 re3 im3
+    __m256d h = _mm256_hadd_pd(_mm256_mul_pd(a, a), _mm256_mul_pd(b, b)); // m0 m2 m1 m3
+    return _mm256_permute4x64_pd(h, _MM_SHUFFLE(3, 1, 2, 0));
+}
+
+__attribute__((target("avx2")))
+static void amplitudeAvx2(const complex double *X, float *out, int n, double scale) {
+    const double *x = (const double *)X;
+    const __m256d s = _mm256_set1_pd(scale);
+    int k = 0;
+    for (; k + 4 <= n; k += 4) {
+        __m256d m = _mm256_mul_pd(s, _mm256_sqrt_pd(squaredMagnitude4(&x[2 * k])));
+        _mm_storeu_ps(&out[k], _mm256_cvtpd_ps(m));
+    }
+    amplitudeScalar(&X[k], &out[k], n - k, scale);
+}
+
+__attribute__((target("avx2")))
+static void convertCenterU16FAvx2(const uint16_t *in, float offset, float *out, int n) {
+    const __m256 off = _mm256_set1_ps(offset);
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m256i v = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)&in[i]));
+        _mm256_storeu_ps(&out[i], _mm256_sub_ps(_mm256_cvtepi32_ps(v), off));
+    }
+    convertCenterU16FScalar(&in[i], offset, &out[i], n - i);
+}
+
+__attribute__((target("avx2")))
+static void amplitudeFAvx2(const complex float *X, float *out, int n, float scale) {
+    const float *x = (const float *)X;
+    const __m256 s = _mm256_set1_ps(scale);
+    int k = 0;
+    for (; k + 8 <= n; k += 8) {
+        __m256 a = _mm256_loadu_ps(&x[2 * k]);      // re0 im0 .. re3 im3
+        __m256 b = _mm256_loadu_ps(&x[2 * k + 8]);  // re4 im4 .. re7 im7
+        a = _mm256_mul_ps(a, a);
+        b = _mm256_mul_ps(b, b);
+        // In-lane shuffles give the bins in order 0 1 4 5 2 3 6 7
+        __m256 m = _mm256_add_ps(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)),
+                                 _mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+        m = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(m), _MM_SHUFFLE(3, 1, 2, 0)));
+        _mm256_storeu_ps(&out[k], _mm256_mul_ps(s, _mm256_sqrt_ps(m)));
+    }
+    amplitudeFScalar(&X[k], &out[k], n - k, scale);
+}
+
+/* Goertzel recurrence, 16 bins at a time (4 vectors of 4) */
+__attribute__((target("avx2")))
+static void goertzelU16Avx2(const uint16_t *x, int n, double offset, const double *coef,
+                            double *s1, double *s2, int nbins) {
+    int j = 0;
+    for (; j + 16 <= nbins; j += 16) {
+        __m256d c[4], a[4], b[4];
+        for (int l = 0; l < 4; l++) {
+            c[l] = _mm256_loadu_pd(&coef[j + 4 * l]);
+            a[l] = _mm256_loadu_pd(&s1[j + 4 * l]);
+            b[l] = _mm256_loadu_pd(&s2[j + 4 * l]);
+        }
+        for (int i = 0; i < n; i++) {
+            __m256d v = _mm256_set1_pd((double)x[i] - offset);
+            for (int l = 0; l < 4; l++) {
+                __m256d t = _mm256_add_pd(_mm256_sub_pd(v, b[l]), _mm256_mul_pd(c[l], a[l]));
+                b[l] = a[l];
+                a[l] = t;
+            }
+        }
+        for (int l = 0; l < 4; l++) {
+            _mm256_storeu_pd(&s1[j + 4 * l], a[l]);
+            _mm256_storeu_pd(&s2[j + 4 * l], b[l]);
+        }
+    }
+    goertzelU16Sse2(x, n, offset, &coef[j], &s1[j], &s2[j], nbins - j);
+}
+
+__attribute__((target("avx2")))
+static int argmaxBandAvx2(const float *A, int kmin, int kmax) {
+    int n = kmax - kmin + 1;
+    if (n < 16) return argmaxBandScalar(A, kmin, kmax);
+
+    __m256 maxV = _mm256_loadu_ps(&A[kmin]);
+    __m256i maxI = _mm256_add_epi32(_mm256_set1_epi32(kmin), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+    __m256i idx = maxI;
+    const __m256i eight = _mm256_set1_epi32(8);
+    int k = kmin + 8;
+
+    for (; k + 8 <= kmax + 1; k += 8) {
+        idx = _mm256_add_epi32(idx, eight);
+        __m256 v = _mm256_loadu_ps(&A[k]);
+        __m256 gt = _mm256_cmp_ps(v, maxV, _CMP_GT_OQ);
+        maxV = _mm256_blendv_ps(maxV, v, gt);
+        maxI = _mm256_blendv_epi8(maxI, idx, _mm256_castps_si256(gt));
+    }
+
+    float vals[8];
+    int idxs[8];
+    _mm256_storeu_ps(vals, maxV);
+    _mm256_storeu_si256((__m256i *)idxs, maxI);
+
+    int best = idxs[0];
+    float bestV = vals[0];
+    for (int l = 1; l < 8; l++) {
+        if (vals[l] > bestV || (vals[l] == bestV && idxs[l] < best)) {
+            bestV = vals[l];
+            best = idxs[l];
+        }
+    }
+    for (; k <= kmax; k++) {
+        if (A[k] > bestV) {
+            bestV = A[k];
+            best = k;
+        }
+    }
+    return best;
+}
+#endif
+
+/* ***********************************************
+ * Dispatch
+ * ***********************************************/
+void (*kConvertCenterU16)(const uint16_t *in, double offset, double *out, int n) = convertCenterU16Scalar;
+void (*kApplyWindow)(const float *in, const float *w, float *out, int n) = applyWindowScalar;
+void (*kAmplitude)(const complex double *X, float *out, int n, double scale) = amplitudeScalar;
+void (*kConvertCenterU16F)(const uint16_t *in, float offset, float *out, int n) = convertCenterU16FScalar;
+void (*kAmplitudeF)(const complex float *X, float *out, int n, float scale) = amplitudeFScalar;
+int (*kArgmaxBand)(const float *A, int kmin, int kmax) = argmaxBandScalar;
+void (*kGoertzelU16)(const uint16_t *x, int n, double offset, const double *coef,
+                     double *s1, double *s2, int nbins) = goertzelU16Scalar;
+
+static int isaSupported(kernelsIsa isa) {
+    switch (isa) {
+    case KERNELS_SCALAR:
+        return 1;
+#ifdef KERNELS_X86
+    case KERNELS_SSE2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("sse2");
+    case KERNELS_AVX2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+#endif
+    default:
+        return 0;
+    }
+}
+
+int kernelsSelect(kernelsIsa isa) {
+    if (!isaSupported(isa)) return -1;
+
+    switch (isa) {
+#ifdef KERNELS_X86
+    case KERNELS_AVX2:
+        kConvertCenterU16 = convertCenterU16Avx2;
+        kApplyWindow = applyWindowAvx2;
+        kAmplitude = amplitudeAvx2;
+        kConvertCenterU16F = convertCenterU16FAvx2;
+        kAmplitudeF = amplitudeFAvx2;
+        kArgmaxBand = argmaxBandAvx2;
+        kGoertzelU16 = goertzelU16Avx2;
+        break;
+    case KERNELS_SSE2:
+        kConvertCenterU16 = convertCenterU16Sse2;
+        kApplyWindow = applyWindowSse2;
+        kAmplitude = amplitudeSse2;
+        kConvertCenterU16F = convertCenterU16FSse2;
+        kAmplitudeF = amplitudeFSse2;
+        kArgmaxBand = argmaxBandSse2;
+        kGoertzelU16 = goertzelU16Sse2;
+        break;
+#endif
+    default:
+        kConvertCenterU16 = convertCenterU16Scalar;
+        kApplyWindow = applyWindowScalar;
+        kAmplitude = amplitudeScalar;
+        kConvertCenterU16F = convertCenterU16FScalar;
+        kAmplitudeF = amplitudeFScalar;
+        kArgmaxBand = argmaxBandScalar;
+        kGoertzelU16 = goertzelU16Scalar;
+        break;
+    }
+    return 0;
+}
+
+kernelsIsa kernelsInit(void) {
+    if (kernelsSelect(KERNELS_AVX2) == 0) return KERNELS_AVX2;
+    if (kernelsSelect(KERNELS_SSE2) == 0) return KERNELS_SSE2;
+    kernelsSelect(KERNELS_SCALAR);
+    return KERNELS_SCALAR;
+}
+
+const char *kernelsIsaName(kernelsIsa isa) {
+    switch (isa) {
+    case KERNELS_SSE2: return "sse2";
+    case KERNELS_AVX2: return "avx2";
+    default:           return "scalar";
+    }
+}
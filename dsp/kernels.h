@@ -0,0 +1,89 @@
+/* ************************************************************
+ * Vectorized kernels for the loops around the FFT
+ *
+ *    - kConvertCenterU16: uint16 samples -> double, minus a DC offset
+ *    - kApplyWindow:      element-wise product (window, gain curve)
+ *    - kAmplitude:        scale*|X[k]| of a complex array
+ *    - kArgmaxBand:       index of the largest value in [kmin, kmax]
+ *    - kGoertzelU16:      Goertzel recurrence of a bank of bins (goertzel.h)
+ *    - kConvertCenterU16F, kAmplitudeF: float versions, for the
+ *      single-precision FFT (fftExecuteRealPackedF)
+ *
+ * Each kernel has a scalar, an SSE2 and an AVX2 version. The kernels
+ * are called through function pointers: they start as the scalar
+ * versions and kernelsInit() selects the best set for the CPU (CPUID).
+ * The versions are equal to within rounding: they may order the
+ * operations differently (the vector Goertzel step computes
+ * (x - s2) + c*s1, the scalar one x + c*s1 - s2) and the vector
+ * amplitudes use sqrt(a^2 + b^2) instead of cabs. bench/kernels_bench
+ * checks every version against the scalar one with a stated tolerance.
+ * The conversions, the window and argmax are exact (argmax returns the
+ * first index of the maximum, as a plain scalar scan would).
+ * ************************************************************/
+
+#ifndef _KERNELS_H
+#define _KERNELS_H
+
+#include <stdint.h>
+#include <complex.h>
+
+typedef enum {
+    KERNELS_SCALAR,
+    KERNELS_SSE2,
+    KERNELS_AVX2
+} kernelsIsa;
+
+/* *******************************************************************
+ * Selects the best kernel set supported by the CPU
+ * Call once at startup, before the threads that use the kernels
+ * Returns the selected set
+ * *******************************************************************/
+kernelsIsa kernelsInit(void);
+
+/* *******************************************************************
+ * Forces a kernel set (e.g. for benchmarks)
+ * Returns 0, or -1 if the CPU does not support it (nothing changes)
+ * *******************************************************************/
+int kernelsSelect(kernelsIsa isa);
+
+/* Name of a kernel set ("scalar", "sse2", "avx2") */
+const char *kernelsIsaName(kernelsIsa isa);
+
+/* *******************************************************************
+ * out[i] = (double)in[i] - offset, i = 0 .. n-1
+ * With n even, out can be a complex double array of n/2 elements
+ * holding pairs of consecutive samples (see fftExecuteRealPacked)
+ * *******************************************************************/
+extern void (*kConvertCenterU16)(const uint16_t *in, double offset, double *out, int n);
+
+/* *******************************************************************
+ * out[i] = in[i] * w[i], i = 0 .. n-1 (out may be in)
+ * *******************************************************************/
+extern void (*kApplyWindow)(const float *in, const float *w, float *out, int n);
+
+/* *******************************************************************
+ * out[k] = scale * |X[k]|, k = 0 .. n-1
+ * *******************************************************************/
+extern void (*kAmplitude)(const complex double *X, float *out, int n, double scale);
+
+/* *******************************************************************
+ * Float versions: out[i] = (float)in[i] - offset, out[k] = scale*|X[k]|
+ * *******************************************************************/
+extern void (*kConvertCenterU16F)(const uint16_t *in, float offset, float *out, int n);
+extern void (*kAmplitudeF)(const complex float *X, float *out, int n, float scale);
+
+/* *******************************************************************
+ * Returns the first index of the largest A[k], kmin <= k <= kmax
+ * (kmin if the band is empty)
+ * *******************************************************************/
+extern int (*kArgmaxBand)(const float *A, int kmin, int kmax);
+
+/* *******************************************************************
+ * For each bin j < nbins and each sample i < n:
+ *     s0 = (x[i] - offset) + coef[j]*s1[j] - s2[j]; s2[j] = s1[j]; s1[j] = s0
+ * (bins are independent: the versions process several at a time)
+ * *******************************************************************/
+extern void (*kGoertzelU16)(const uint16_t *x, int n, double offset, const double *coef,
+                            double *s1, double *s2, int nbins);
+
+#endif
@@ -0,0 +1,55 @@
+/* ************************************************************
+ * Sub-bin peak interpolation
+ * ************************************************************/
+
+#include <stddef.h>
+#include <math.h>
+#include "peak.h"
+
+/* Vertex of the parabola through (-1, a), (0, b), (1, c) */
+static double vertex(double a, double b, double c, double *v) {
+    double den = a - 2.0 * b + c;
+    double d = (den < 0.0) ? 0.5 * (a - c) / den : 0.0;
+
+    *v = b - 0.25 * (a - c) * d;
+    return d;
+}
+
+double peakInterpolate(const float *A, int n, int k, peakMethod m, float *amp) {
+    double a, b, c, d = 0.0, v;
+
+    if (amp != NULL) *amp = A[k];
+    if (k < 1 || k > n - 2) return k;
+
+    a = A[k - 1];
+    b = A[k];
+    c = A[k + 1];
+    if (b <= 0.0 || a > b || c > b) return k;
+
+    switch (m) {
+    case PEAK_QUADRATIC:
+        d = vertex(a, b, c, &v);
+        break;
+    case PEAK_GAUSSIAN:
+        if (a <= 0.0 || c <= 0.0) return k;
+        d = vertex(log(a), log(b), log(c), &v);
+        v = exp(v);
+        break;
+    case PEAK_RECT: {
+        /* |sinc| main lobe: the neighbour on the side of the tone holds
+         * d/(1-d) of the peak amplitude */
+        double r = (c > a) ? c / b : a / b;
+        d = r / (1.0 + r);
+        if (a > c) d = -d;
+        v = (d != 0.0) ? b * M_PI * d / sin(M_PI * d) : b;
+        break;
+    }
+    default:
+        return k;
+    }
+
+    if (d > 0.5) d = 0.5;
+    if (d < -0.5) d = -0.5;
+    if (amp != NULL) *amp = (float)v;
+    return k + d;
+}
@@ -0,0 +1,39 @@
+/* ************************************************************
+ * Sub-bin peak interpolation
+ *
+ * Refines the position of a spectral peak found at bin k from the
+ * amplitudes of bins k-1, k, k+1, so that a peak frequency is not
+ * quantized to k*fs/N (~10.8 Hz with N = 4096 at 44.1 kHz):
+ *    - PEAK_QUADRATIC: parabola through the three amplitudes
+ *    - PEAK_GAUSSIAN:  parabola through their logarithms; suited to
+ *      windowed (e.g. Hann, see stft.h) spectra
+ *    - PEAK_RECT:      ratio of the largest neighbour to the peak;
+ *      exact for a pure tone in an unwindowed block (as spec_buffer)
+ * A few flops per peak, against a transform of twice the size for a
+ * twice finer grid (see bench/peak_bench).
+ * ************************************************************/
+
+#ifndef _PEAK_H
+#define _PEAK_H
+
+typedef enum {
+    PEAK_BIN,       /* No interpolation: k */
+    PEAK_QUADRATIC,
+    PEAK_GAUSSIAN,
+    PEAK_RECT
+} peakMethod;
+
+/* *******************************************************************
+ * Fractional bin of the peak at bin k
+ * Args are:
+ * 		const float *A: amplitude spectrum
+ * 		int n: number of bins in A
+ * 		int k: bin of the local maximum (e.g. from kArgmaxBand)
+ * 		peakMethod m: interpolation method
+ * 		float *amp: if not NULL, receives the interpolated amplitude
+ * Returns k + d, -0.5 <= d <= 0.5 (d = 0 at the edges of A, or if the
+ * neighbours are not below A[k]). Multiply by fs/N to get Hz.
+ * *******************************************************************/
+double peakInterpolate(const float *A, int n, int k, peakMethod m, float *amp);
+
+#endif
@@ -0,0 +1,132 @@
+/* ************************************************************
+ * Streaming (sliding-window) STFT
+ * ************************************************************/
+
+#include <stdlib.h>
+#include <math.h>
+#include "stft.h"
+#include "kernels.h"
+
+int stftInit(stft *s, int N, int hop, uint32_t size) {
+
+    if (N < 4 || (N & (N - 1)) != 0 || hop < 1 || hop > N
+        || size < 2u * N || (size & (size - 1)) != 0) {
+        return -1;
+    }
+
+    s->N = N;
+    s->hop = hop;
+    s->size = size;
+    s->ring = calloc(size, sizeof(float));
+    s->window = malloc(N * sizeof(float));
+    s->X = malloc((N/2 + 1) * sizeof(complex float));
+    s->plan = fftRealPlanCreateF(N);
+    if (s->ring == NULL || s->window == NULL || s->X == NULL || s->plan == NULL) {
+        stftDestroy(s);
+        return -1;
+    }
+
+    /* Periodic Hann window: sum is N/2 */
+    double sum = 0.0;
+    for (int i = 0; i < N; i++) {
+        s->window[i] = (float)(0.5 - 0.5 * cos(2.0 * M_PI * i / N));
+        sum += s->window[i];
+    }
+    s->scale = (float)(2.0 / sum);
+
+    atomic_init(&s->head, 0);
+    atomic_init(&s->tail, 0);
+    atomic_init(&s->dropped, 0);
+    return 0;
+}
+
+void stftDestroy(stft *s) {
+    free(s->ring);
+    free(s->window);
+    free(s->X);
+    fftRealPlanDestroyF(s->plan);
+    s->ring = NULL;
+    s->window = NULL;
+    s->X = NULL;
+    s->plan = NULL;
+}
+
+void stftReset(stft *s) {
+    atomic_store(&s->head, 0);
+    atomic_store(&s->tail, 0);
+    atomic_store(&s->dropped, 0);
+}
+
+int stftWriteU16(stft *s, const uint16_t *x, int n, float offset) {
+    unsigned head = atomic_load_explicit(&s->head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&s->tail, memory_order_acquire);
+    unsigned room = s->size - (head - tail);
+
+    if ((unsigned)n > room) {
+        atomic_fetch_add_explicit(&s->dropped, n - room, memory_order_relaxed);
+        n = room;
+    }
+
+    /* Two copies when the block wraps around the end of the ring */
+    unsigned start = head & (s->size - 1);
+    int first = (s->size - start < (unsigned)n) ? (int)(s->size - start) : n;
+    kConvertCenterU16F(x, offset, s->ring + start, first);
+    kConvertCenterU16F(x + first, offset, s->ring, n - first);
+
+    atomic_store_explicit(&s->head, head + n, memory_order_release);
+    return n;
+}
+
+int stftFrame(stft *s, float *Ak) {
+    const int N = s->N;
+    unsigned tail = atomic_load_explicit(&s->tail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&s->head, memory_order_acquire);
+
+    if (head - tail < (unsigned)N) return 0;
+
+    /* Windowed samples, packed as the real FFT expects them */
+    float *x = (float *)s->X;
+    unsigned start = tail & (s->size - 1);
+    int first = (s->size - start < (unsigned)N) ? (int)(s->size - start) : N;
+    kApplyWindow(s->ring + start, s->window, x, first);
+    kApplyWindow(s->ring, s->window + first, x + first, N - first);
+
+    /* The samples were copied: the producer may reuse them */
+    atomic_store_explicit(&s->tail, tail + s->hop, memory_order_release);
+
+    fftExecuteRealPackedF(s->plan, s->X);
+    kAmplitudeF(s->X, Ak, N/2 + 1, s->scale);
+    Ak[0] *= 0.5f;
+    Ak[N/2] *= 0.5f;
+    return 1;
+}
+
+int stftSkip(stft *s) {
+    unsigned tail = atomic_load_explicit(&s->tail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&s->head, memory_order_acquire);
+
+    if (head - tail < (unsigned)s->N) return 0;
+    atomic_store_explicit(&s->tail, tail + s->hop, memory_order_release);
+    return 1;
+}
+
+int stftLatest(stft *s, float *Ak) {
+    const int N = s->N;
+    unsigned tail = atomic_load_explicit(&s->tail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&s->head, memory_order_acquire);
+
+    if (head - tail < (unsigned)N) return 0;
+
+    /* Older complete frames are skipped, not transformed */
+    tail += (head - tail - N) / s->hop * s->hop;
+    atomic_store_explicit(&s->tail, tail, memory_order_release);
+    return stftFrame(s, Ak);
+}
+
+unsigned stftHead(stft *s) {
+    return atomic_load_explicit(&s->head, memory_order_acquire);
+}
+
+unsigned stftNextEnd(stft *s) {
+    return atomic_load_explicit(&s->tail, memory_order_relaxed) + s->N;
+}
@@ -0,0 +1,100 @@
+/* ************************************************************
+ * Streaming (sliding-window) STFT
+ *
+ * Keeps the most recent samples of a stream in a ring and computes
+ * overlapped, Hann-windowed frames of N samples every hop samples:
+ * with hop = N/4 consecutive frames overlap by 75%, and every sample
+ * of the stream belongs to N/hop frames (no gaps between blocks).
+ *
+ * One producer (stftWriteU16) and one consumer (stftFrame) may run in
+ * different threads without locks: the ring indices are C11 atomics.
+ * Memory is allocated by stftInit() only, before the real-time loop.
+ * The frames use the single-precision FFT (fftExecuteRealPackedF).
+ * ************************************************************/
+
+#ifndef _STFT_H
+#define _STFT_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <complex.h>
+#include "../fft/fft.h"
+
+typedef struct {
+    int N;                      /* Frame size (power of 2, >= 4) */
+    int hop;                    /* Samples between frame starts (1 .. N) */
+    uint32_t size;              /* Ring capacity (power of 2, >= 2N) */
+    float *ring;                /* Centered samples */
+    atomic_uint head;           /* Samples written (producer) */
+    atomic_uint tail;           /* Start of the next frame (consumer) */
+    atomic_uint dropped;        /* Samples dropped because the ring was full */
+    float *window;              /* Hann window, N samples */
+    float scale;                /* 2 / sum(window): amplitude scaling */
+    fftRealPlanF *plan;
+    complex float *X;           /* Frame being transformed, N/2+1 bins */
+} stft;
+
+/* *******************************************************************
+ * Allocates the ring, window and FFT plan
+ * Args are:
+ * 		stft *s: the STFT
+ * 		int N: frame size. *** MUST BE A POWER OF 2, >= 4 ****
+ * 		int hop: samples between frames (N/4: 75% overlap)
+ * 		uint32_t size: ring capacity, power of 2 >= 2N. Must hold the
+ *                    samples that arrive between two consumer runs, plus N
+ * Returns 0, or -1 if an argument is invalid or memory is exhausted
+ * *******************************************************************/
+int stftInit(stft *s, int N, int hop, uint32_t size);
+
+/* *******************************************************************
+ * Releases the memory held by the STFT
+ * *******************************************************************/
+void stftDestroy(stft *s);
+
+/* *******************************************************************
+ * Empties the ring (e.g. before a stream that does not follow the
+ * previous one). Not concurrently with the producer or the consumer
+ * *******************************************************************/
+void stftReset(stft *s);
+
+/* *******************************************************************
+ * Producer: appends n raw 16-bit samples, minus offset, to the stream
+ * Returns the number of samples stored (< n if the ring is full; the
+ * others are counted in s->dropped)
+ * *******************************************************************/
+int stftWriteU16(stft *s, const uint16_t *x, int n, float offset);
+
+/* *******************************************************************
+ * Consumer: computes the next frame, if N samples are available from
+ * its start, and advances by hop samples
+ * Args are:
+ * 		stft *s: the STFT
+ * 		float *Ak: output, amplitude of bins 0 (DC) .. N/2 (fs/2),
+ *                    scaled as fftGetAmplitude() does for a plain block
+ * Returns 1 if a frame was computed, 0 if not enough samples yet
+ * *******************************************************************/
+int stftFrame(stft *s, float *Ak);
+
+/* *******************************************************************
+ * Consumer: skips the next frame, if N samples are available from its
+ * start (advances by hop samples, as stftFrame, without computing it)
+ * Returns 1 if a frame was skipped, 0 if not enough samples yet
+ * *******************************************************************/
+int stftSkip(stft *s);
+
+/* *******************************************************************
+ * Consumer: computes only the most recent complete frame, skipping
+ * the older ones (e.g. one estimate per block), as stftFrame
+ * *******************************************************************/
+int stftLatest(stft *s, float *Ak);
+
+/* *******************************************************************
+ * Stream positions (samples since stftInit/stftReset, modulo 2^32)
+ *    stftHead: samples written so far (producer, or consumer)
+ *    stftNextEnd: one past the last sample of the next frame
+ *                 (consumer): ready once stftHead has reached it
+ * *******************************************************************/
+unsigned stftHead(stft *s);
+unsigned stftNextEnd(stft *s);
+
+#endif
@@ -1,47 +1,232 @@
-
 /* ************************************************************
  * Paulo Pedreiras, pbrp@ua.pt
  * 2024/Sept
  * 
  * C module to compute the Fast Fourier Transform (FFT) of an array
- * using the (recursive) Cooley-Tukey algorithm.  
+ * using the (iterative, radix-2) Cooley-Tukey algorithm.  
  
  * ************************************************************/
 
-#ifndef FFT_H
-#define FFT_H
-
 #include <stdio.h>
+#include <stdlib.h>
 #include <math.h>
 #include <complex.h>
+#include <pthread.h>
 #include "fft.h"
 
+#define FFT_MAX_LOG2N 31
+
+/* Plans used by the fftCompute() wrapper, one per log2(N) */
+static fftPlan *planCache[FFT_MAX_LOG2N + 1];
+static pthread_mutex_t planCacheMutex = PTHREAD_MUTEX_INITIALIZER;
+
 /* *******************************************************************
- * Function to perform the FFT (recursive version) 
+ * Creates a plan for N-point transforms
  * *******************************************************************/
-void fftCompute(complex double *X, int N) {
-    
-    if (N <= 1) return;  // Base case: FFT of size 1 is the same
+fftPlan *fftPlanCreate(int N) {
+
+    if (N < 1 || (N & (N - 1)) != 0) return NULL;  // Not a power of 2
+
+    fftPlan *plan = malloc(sizeof(fftPlan));
+    if (plan == NULL) return NULL;
 
-    // Split even and odd terms
-    complex double even[N/2];
-    complex double odd[N/2];
+    plan->N = N;
+    plan->log2N = 0;
+    while ((1 << plan->log2N) < N) plan->log2N++;
 
-    for (int i = 0; i < N/2; i++) {
-        even[i] = X[i * 2];
-        odd[i] = X[i * 2 + 1];
+    plan->bitrev = malloc(N * sizeof(uint32_t));
+    plan->twiddle = malloc((N/2 > 0 ? N/2 : 1) * sizeof(complex double));
+    if (plan->bitrev == NULL || plan->twiddle == NULL) {
+        fftPlanDestroy(plan);
+        return NULL;
     }
 
-    // Recursively apply FFT to even and odd terms
-    fftCompute(even, N/2);
-    fftCompute(odd, N/2);
+    for (int i = 0; i < N; i++) {
+        uint32_t r = 0;
+        for (int b = 0; b < plan->log2N; b++) {
+            if (i & (1 << b)) r |= 1u << (plan->log2N - 1 - b);
+        }
+        plan->bitrev[i] = r;
+    }
 
-    // Combine results
     for (int k = 0; k < N/2; k++) {
-        complex double t = cexp(-2.0 * I * M_PI * k / N) * odd[k];
-        X[k]       = even[k] + t;
-        X[k + N/2] = even[k] - t;
+        plan->twiddle[k] = cexp(-2.0 * I * M_PI * k / N);
     }
+
+    return plan;
+}
+
+/* *******************************************************************
+ * Releases the memory held by a plan
+ * *******************************************************************/
+void fftPlanDestroy(fftPlan *plan) {
+    if (plan == NULL) return;
+    free(plan->bitrev);
+    free(plan->twiddle);
+    free(plan);
+}
+
+/* *******************************************************************
+ * Function to perform the FFT (iterative, in-place version)
+ * *******************************************************************/
+void fftExecute(const fftPlan *plan, complex double *X) {
+
+    const int N = plan->N;
+    double *x = (double *)X;    // Interleaved re/im view of X
+
+    // Reorder input in bit-reversed order
+    for (int i = 0; i < N; i++) {
+        uint32_t j = plan->bitrev[i];
+        if (i < j) {
+            complex double t = X[i];
+            X[i] = X[j];
+            X[j] = t;
+        }
+    }
+
+    // Butterflies, from 2-point to N-point transforms
+    // The complex products are expanded by hand to avoid the C99
+    // NaN/Inf recovery code (__muldc3) emitted for complex multiplies
+    for (int len = 2, step = N/2; len <= N; len <<= 1, step >>= 1) {
+        int half = len/2;
+        for (int i = 0; i < N; i += len) {
+            for (int k = 0; k < half; k++) {
+                const double *w = (const double *)&plan->twiddle[k * step];
+                double *a = &x[2 * (i + k)];
+                double *b = &x[2 * (i + k + half)];
+                double tr = w[0] * b[0] - w[1] * b[1];
+                double ti = w[0] * b[1] + w[1] * b[0];
+                b[0] = a[0] - tr;
+                b[1] = a[1] - ti;
+                a[0] += tr;
+                a[1] += ti;
+            }
+        }
+    }
+}
+
+/* *******************************************************************
+ * Creates a plan for N-point real-input transforms
+ * *******************************************************************/
+fftRealPlan *fftRealPlanCreate(int N) {
+
+    if (N < 4 || (N & (N - 1)) != 0) return NULL;  // Not a power of 2
+
+    fftRealPlan *plan = malloc(sizeof(fftRealPlan));
+    if (plan == NULL) return NULL;
+
+    plan->N = N;
+    plan->half = fftPlanCreate(N/2);
+    plan->twiddle = malloc((N/4 + 1) * sizeof(complex double));
+    if (plan->half == NULL || plan->twiddle == NULL) {
+        fftRealPlanDestroy(plan);
+        return NULL;
+    }
+
+    for (int k = 0; k <= N/4; k++) {
+        plan->twiddle[k] = cexp(-2.0 * I * M_PI * k / N);
+    }
+
+    return plan;
+}
+
+/* *******************************************************************
+ * Releases the memory held by a real-input plan
+ * *******************************************************************/
+void fftRealPlanDestroy(fftRealPlan *plan) {
+    if (plan == NULL) return;
+    fftPlanDestroy(plan->half);
+    free(plan->twiddle);
+    free(plan);
+}
+
+/* *******************************************************************
+ * Splits Z, the N/2-point FFT of z[n] = x[2n] + i*x[2n+1], into the
+ * N/2+1 first bins of the FFT of x (in place):
+ *    E[k] = (Z[k] + conj(Z[N/2-k]))/2       (even samples)
+ *    O[k] = (Z[k] - conj(Z[N/2-k]))/(2i)    (odd samples)
+ *    X[k] = E[k] + W^k O[k],  X[N/2-k] = conj(E[k] - W^k O[k])
+ * *******************************************************************/
+static void fftRealSplit(const fftRealPlan *plan, complex double *X) {
+
+    const int M = plan->N/2;
+
+    double z0r = creal(X[0]), z0i = cimag(X[0]);
+    X[0] = z0r + z0i;
+    X[M] = z0r - z0i;
+
+    for (int k = 1; k <= M/2; k++) {
+        int m = M - k;
+        double ar = creal(X[k]), ai = cimag(X[k]);
+        double br = creal(X[m]), bi = cimag(X[m]);
+        double wr = creal(plan->twiddle[k]), wi = cimag(plan->twiddle[k]);
+
+        double er = 0.5 * (ar + br), ei = 0.5 * (ai - bi);    // E[k]
+        double or = 0.5 * (ai + bi), oi = -0.5 * (ar - br);   // O[k]
+        double tr = wr * or - wi * oi, ti = wr * oi + wi * or; // W^k O[k]
+
+        X[k] = CMPLX(er + tr, ei + ti);
+        X[m] = CMPLX(er - tr, -(ei - ti));
+    }
+}
+
+/* *******************************************************************
+ * Function to perform the FFT of real samples
+ * *******************************************************************/
+void fftExecuteReal(const fftRealPlan *plan, const double *x, complex double *X) {
+
+    for (int n = 0; n < plan->N/2; n++) {
+        X[n] = CMPLX(x[2 * n], x[2 * n + 1]);
+    }
+    fftExecuteRealPacked(plan, X);
+}
+
+/* *******************************************************************
+ * Same as fftExecuteReal(), for raw 16-bit samples
+ * *******************************************************************/
+void fftExecuteRealU16(const fftRealPlan *plan, const uint16_t *x, double offset,
+                       complex double *X) {
+
+    for (int n = 0; n < plan->N/2; n++) {
+        X[n] = CMPLX((double)x[2 * n] - offset, (double)x[2 * n + 1] - offset);
+    }
+    fftExecuteRealPacked(plan, X);
+}
+
+/* *******************************************************************
+ * Same as fftExecuteReal(), with the samples already packed in X
+ * *******************************************************************/
+void fftExecuteRealPacked(const fftRealPlan *plan, complex double *X) {
+    fftExecute(plan->half, X);
+    fftRealSplit(plan, X);
+}
+
+/* *******************************************************************
+ * Function to perform the FFT (compatibility wrapper) 
+ * *******************************************************************/
+void fftCompute(complex double *X, int N) {
+
+    if (N <= 1) return;  // FFT of size 1 is the same
+
+    int log2N = 0;
+    while ((1 << log2N) < N && log2N < FFT_MAX_LOG2N) log2N++;
+
+    fftPlan *plan = __atomic_load_n(&planCache[log2N], __ATOMIC_ACQUIRE);
+    if (plan == NULL) {
+        pthread_mutex_lock(&planCacheMutex);
+        plan = planCache[log2N];
+        if (plan == NULL) {
+            plan = fftPlanCreate(N);
+            __atomic_store_n(&planCache[log2N], plan, __ATOMIC_RELEASE);
+        }
+        pthread_mutex_unlock(&planCacheMutex);
+        if (plan == NULL) {
+            fprintf(stderr, "fftCompute: cannot create a plan for N=%d\n", N);
+            return;
+        }
+    }
+
+    fftExecute(plan, X);
 }
 
 /* **********************************************************
@@ -55,7 +240,7 @@ void fftGetAmplitude(complex double * X, int N, int fs, float * fk, float * Ak)
     /* Compute freqs: from 0/DC to fs, obver the N bins */
     /* Output vector is mirrored, so only the first N/2 bins are relevant */
     for(k=0; k<=N/2; k++) {
-		fk[k]=k*fs/N;		
+		fk[k]=(float)k*fs/N;		
 //		printf("fk[%d]=%f\n",k,fk[k]);
 	}
     
@@ -81,5 +266,3 @@ void printComplexArray(complex double *X, int N) {
         printf("%g + %gi\n", creal(X[i]), cimag(X[i]));
     }
 }
-
-#endif
\ No newline at end of file
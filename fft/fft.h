@@ -1,35 +1,171 @@
 /* ************************************************************
  * Paulo Pedreiras, pbrp@ua.pt
  * 2024/Sept
- * 
+ *
  * C module to compute the Fast Fourier Transform (FFT) of an array
- * using the (recursive) Cooley-Tukey algorithm. 
+ * using the Cooley-Tukey algorithm.
  * Requires that the number of elements is a power of 2.
- * 
+ *
  * The function takes as input and returns an array of complex numbers.
  * The input array has real numbers - the samples
- * The output is an array of complex numbers that represent the frequency 
+ * The output is an array of complex numbers that represent the frequency
  *    components of the original signal.
- * Note that the FFT output array is mirrored and gives the frequency 
- *    components from 0 Hz to fs/2 as complex numbers and in N bins. 
- *    Bin [0] 1 is DC and bin [N/2-1] is fs/2. Note also that the 
- *    magnitudes must be scaled by 2/N, except for Dc and fs/2 which 
+ * Note that the FFT output array is mirrored and gives the frequency
+ *    components from 0 Hz to fs/2 as complex numbers and in N bins.
+ *    Bin [0] 1 is DC and bin [N/2-1] is fs/2. Note also that the
+ *    magnitudes must be scaled by 2/N, except for Dc and fs/2 which
  *    is 1/N (the others are doubled because of mirroring)
- 
+ *
+ * The following interfaces are available:
+ *    - fftPlanCreate()/fftExecute(): the plan holds the twiddle factors
+ *      and the bit-reversal table for a given N, so that the (iterative,
+ *      in-place) transform does no allocation nor trigonometry.
+ *      Create the plan once, before the real-time loop.
+ *    - fftCompute(): compatibility wrapper, uses a plan cached per N.
+ *    - fftRealPlanCreate()/fftExecuteReal(): transform of N real samples
+ *      computed as an N/2-point complex FFT. Only the N/2+1 bins from DC
+ *      to fs/2 are produced (the others are their mirror).
+ *    - The same functions with an F suffix (fftPlanCreateF, ...) work on
+ *      complex float data (single precision, see fftf.c).
+
  * ************************************************************/
 
+#ifndef FFT_H
+#define FFT_H
+
 #include <math.h>
 #include <complex.h>
+#include <stdint.h>
+
+/* *******************************************************************
+ * FFT plan: precomputed tables for one transform size
+ * *******************************************************************/
+typedef struct {
+    int N;                      /* Number of points (power of 2) */
+    int log2N;                  /* log2(N) */
+    uint32_t *bitrev;           /* Bit-reversal permutation (N entries) */
+    complex double *twiddle;    /* exp(-2*pi*i*k/N), k = 0 .. N/2-1 */
+} fftPlan;
+
+/* *******************************************************************
+ * Creates a plan for N-point transforms
+ * Args are:
+ * 		int N: the number of elements. *** MUST BE A POWER OF 2 ****
+ * Returns the plan, or NULL if N is invalid or memory is exhausted
+ * *******************************************************************/
+fftPlan *fftPlanCreate(int N);
+
+/* *******************************************************************
+ * Releases the memory held by a plan
+ * *******************************************************************/
+void fftPlanDestroy(fftPlan *plan);
 
 /* *******************************************************************
- * Function to perform the FFT (recursive version)
+ * Function to perform the FFT (iterative, in-place version)
  * Args are:
- * 		complex double X: the input (real values) and output 
+ * 		const fftPlan *plan: plan created for the size of X
+ * 		complex double X: the input (real values) and output
+ *                    frequency component ampliutude/phase
+ * The plan is read-only, so it can be shared by several threads.
+ * *******************************************************************/
+void fftExecute(const fftPlan *plan, complex double *X);
+
+/* *******************************************************************
+ * Real-input FFT plan: N/2-point complex plan plus the twiddles that
+ * split its output into the spectrum of the N real samples
+ * *******************************************************************/
+typedef struct {
+    int N;                      /* Number of real samples (power of 2, >= 4) */
+    fftPlan *half;              /* N/2-point complex plan */
+    complex double *twiddle;    /* exp(-2*pi*i*k/N), k = 0 .. N/4 */
+} fftRealPlan;
+
+/* *******************************************************************
+ * Creates a plan for N-point real-input transforms
+ * Args are:
+ * 		int N: the number of real samples. *** POWER OF 2, >= 4 ****
+ * Returns the plan, or NULL if N is invalid or memory is exhausted
+ * *******************************************************************/
+fftRealPlan *fftRealPlanCreate(int N);
+
+/* *******************************************************************
+ * Releases the memory held by a real-input plan
+ * *******************************************************************/
+void fftRealPlanDestroy(fftRealPlan *plan);
+
+/* *******************************************************************
+ * Function to perform the FFT of real samples
+ * Args are:
+ * 		const fftRealPlan *plan: plan created for N samples
+ * 		const double *x: the N input samples
+ * 		complex double *X: output, bins 0 (DC) .. N/2 (fs/2).
+ *                    *** MUST HAVE ROOM FOR N/2+1 ELEMENTS ****
+ * X can be passed directly to fftGetAmplitude() with the same N.
+ * *******************************************************************/
+void fftExecuteReal(const fftRealPlan *plan, const double *x, complex double *X);
+
+/* *******************************************************************
+ * Same as fftExecuteReal(), for raw 16-bit samples
+ * Args are:
+ * 		const fftRealPlan *plan: plan created for N samples
+ * 		const uint16_t *x: the N input samples (e.g. AUDIO_U16)
+ * 		double offset: DC offset subtracted from each sample
+ *                    (32768.0 to center unsigned 16-bit audio)
+ * 		complex double *X: output, N/2+1 elements
+ * *******************************************************************/
+void fftExecuteRealU16(const fftRealPlan *plan, const uint16_t *x, double offset,
+                       complex double *X);
+
+/* *******************************************************************
+ * Same as fftExecuteReal(), with the samples already packed in X
+ * Args are:
+ * 		const fftRealPlan *plan: plan created for N samples
+ * 		complex double *X: input, X[n] = x[2n] + i*x[2n+1], i.e. the N
+ *                    samples written in order to X seen as double[N];
+ *                    output, bins 0 .. N/2 (N/2+1 elements)
+ * Lets the caller convert the samples with its own (vectorized) code
+ * *******************************************************************/
+void fftExecuteRealPacked(const fftRealPlan *plan, complex double *X);
+
+/* *******************************************************************
+ * Function to perform the FFT (compatibility wrapper)
+ * Args are:
+ * 		complex double X: the input (real values) and output
  *                    frequency component ampliutude/phase
  * 		int N: the number of elements. *** MUST BE A POWER OF 2 ****
+ * The first call for a given N allocates its plan; real-time code
+ * should create its own plan with fftPlanCreate() instead.
  * *******************************************************************/
 void fftCompute(complex double *X, int N);
 
+/* *******************************************************************
+ * Single-precision (float) variants
+ * Same contracts as the double versions above, on complex float data
+ * *******************************************************************/
+typedef struct {
+    int N;                      /* Number of points (power of 2) */
+    int log2N;                  /* log2(N) */
+    uint32_t *bitrev;           /* Bit-reversal permutation (N entries) */
+    complex float *twiddle;     /* exp(-2*pi*i*k/N), k = 0 .. N/2-1 */
+} fftPlanF;
+
+typedef struct {
+    int N;                      /* Number of real samples (power of 2, >= 4) */
+    fftPlanF *half;             /* N/2-point complex plan */
+    complex float *twiddle;     /* exp(-2*pi*i*k/N), k = 0 .. N/4 */
+} fftRealPlanF;
+
+fftPlanF *fftPlanCreateF(int N);
+void fftPlanDestroyF(fftPlanF *plan);
+void fftExecuteF(const fftPlanF *plan, complex float *X);
+
+fftRealPlanF *fftRealPlanCreateF(int N);
+void fftRealPlanDestroyF(fftRealPlanF *plan);
+void fftExecuteRealF(const fftRealPlanF *plan, const float *x, complex float *X);
+void fftExecuteRealU16F(const fftRealPlanF *plan, const uint16_t *x, float offset,
+                        complex float *X);
+void fftExecuteRealPackedF(const fftRealPlanF *plan, complex float *X);
+
 /* **********************************************************
  *  Converts complex representation of FFT in amplitudes.
  *  Also generates the corresponding frequencies
@@ -49,3 +185,5 @@ void fftGetAmplitude(complex double * X, int N, int fs, float * fk, float * Ak);
  * 		int N: length of the array
  * ******************************************************/
 void printComplexArray(complex double *X, int N);
+
+#endif
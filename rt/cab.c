@@ -0,0 +1,54 @@
+/* ************************************************************
+ * Non-blocking CAB (Cyclic Asynchronous Buffer) control block
+ *
+ * All accesses to last_write and nusers are sequentially consistent:
+ * a reader increments nusers[i] and then checks that i is still
+ * last_write, while the writer publishes and then checks nusers of
+ * the slot it is about to reuse. One of the two always sees the other,
+ * so a slot a reader validated is never overwritten under it.
+ * ************************************************************/
+
+#include "cab.h"
+
+void cabCtrl_init(cabCtrl *c, int nslots) {
+    if (nslots < 2) nslots = 2;
+    if (nslots > CAB_MAX_SLOTS) nslots = CAB_MAX_SLOTS;
+
+    c->nslots = nslots;
+    for (int i = 0; i < CAB_MAX_SLOTS; i++) {
+        atomic_init(&c->nusers[i], 0);
+    }
+    atomic_init(&c->last_write, 0);
+}
+
+int cabCtrl_getWriteSlot(cabCtrl *c) {
+    int last = atomic_load(&c->last_write);
+
+    for (int i = 0; i < c->nslots; i++) {
+        if (i != last && atomic_load(&c->nusers[i]) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void cabCtrl_publish(cabCtrl *c, int index) {
+    atomic_store(&c->last_write, index);
+}
+
+int cabCtrl_getReadSlot(cabCtrl *c) {
+    for (;;) {
+        int i = atomic_load(&c->last_write);
+        atomic_fetch_add(&c->nusers[i], 1);
+        if (atomic_load(&c->last_write) == i) {
+            return i;
+        }
+        // A newer message was published meanwhile: the writer may be
+        // reusing slot i, so drop it and take the new last_write
+        atomic_fetch_sub(&c->nusers[i], 1);
+    }
+}
+
+void cabCtrl_release(cabCtrl *c, int index) {
+    atomic_fetch_sub(&c->nusers[index], 1);
+}
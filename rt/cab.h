@@ -0,0 +1,59 @@
+/* ************************************************************
+ * Non-blocking CAB (Cyclic Asynchronous Buffer) control block
+ *
+ * Keeps the bookkeeping of a CAB with one writer and many readers:
+ * which slot holds the most recent message (last_write) and how many
+ * readers are using each slot (nusers). The messages themselves live
+ * in a typed array owned by the user, slot i being element i.
+ *
+ * Readers and the writer never block nor sleep (C11 atomics only).
+ * With nslots >= (number of readers) + 2 the writer always finds a
+ * free slot: each reader holds at most one slot, plus last_write.
+ * ************************************************************/
+
+#ifndef _CAB_H
+#define _CAB_H
+
+#include <stdatomic.h>
+
+#define CAB_MAX_SLOTS 16
+
+typedef struct {
+    atomic_uint nusers[CAB_MAX_SLOTS];  // readers using each slot
+    atomic_int last_write;              // most recent published slot
+    int nslots;
+} cabCtrl;
+
+/* *******************************************************************
+ * Initializes the control block
+ * Args are:
+ * 		cabCtrl *c: control block
+ * 		int nslots: number of slots (2 .. CAB_MAX_SLOTS)
+ * Slot 0 starts as the published one, so readers always get a slot
+ * *******************************************************************/
+void cabCtrl_init(cabCtrl *c, int nslots);
+
+/* *******************************************************************
+ * Writer: gets a slot that no reader uses and that is not last_write
+ * Returns the slot index, or -1 if none (too few slots for the readers)
+ * Only one thread may write to a given CAB
+ * *******************************************************************/
+int cabCtrl_getWriteSlot(cabCtrl *c);
+
+/* *******************************************************************
+ * Writer: makes a fully written slot the most recent one
+ * *******************************************************************/
+void cabCtrl_publish(cabCtrl *c, int index);
+
+/* *******************************************************************
+ * Reader: gets (and holds) the most recent slot
+ * Lock-free: retries only if a publish races with the call
+ * *******************************************************************/
+int cabCtrl_getReadSlot(cabCtrl *c);
+
+/* *******************************************************************
+ * Reader: releases a slot obtained with cabCtrl_getReadSlot()
+ * *******************************************************************/
+void cabCtrl_release(cabCtrl *c, int index);
+
+#endif
@@ -0,0 +1,85 @@
+/* ************************************************************
+ * Publish/subscribe notification
+ *
+ * The publisher increments seq and then reads waiters; a subscriber
+ * increments waiters and then reads seq (both sequentially consistent),
+ * so either the publisher sees the subscriber and wakes it, or the
+ * subscriber sees the new count and does not sleep. FUTEX_WAIT itself
+ * returns at once if seq changed in between.
+ * ************************************************************/
+
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include "notify.h"
+
+#define NS_IN_SEC 1000000000L
+
+static long futex(atomic_uint *addr, int op, unsigned val, const struct timespec *limit) {
+    return syscall(SYS_futex, addr, op, val, limit, NULL, FUTEX_BITSET_MATCH_ANY);
+}
+
+void notifyInit(rtNotify *n) {
+    atomic_init(&n->seq, 0);
+    atomic_init(&n->waiters, 0);
+    atomic_init(&n->closed, 0);
+    atomic_init(&n->time_ns, 0);
+}
+
+void notifyPublish(rtNotify *n) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    atomic_store_explicit(&n->time_ns, (uint64_t)now.tv_sec * NS_IN_SEC + now.tv_nsec,
+                          memory_order_relaxed);
+    atomic_fetch_add(&n->seq, 1);
+    if (atomic_load(&n->waiters) > 0) {
+        futex(&n->seq, FUTEX_WAKE_PRIVATE, INT_MAX, NULL);
+    }
+}
+
+void notifyClose(rtNotify *n) {
+    atomic_store(&n->closed, 1);
+    atomic_fetch_add(&n->seq, 1);
+    futex(&n->seq, FUTEX_WAKE_PRIVATE, INT_MAX, NULL);
+}
+
+unsigned notifySeq(rtNotify *n) {
+    return atomic_load_explicit(&n->seq, memory_order_acquire);
+}
+
+unsigned notifyWait(rtNotify *n, unsigned last, unsigned count, struct timespec *time) {
+    unsigned seq = atomic_load(&n->seq);
+
+    if (seq - last < count) {
+        atomic_fetch_add(&n->waiters, 1);
+        while ((seq = atomic_load(&n->seq)) - last < count && !atomic_load(&n->closed)) {
+            futex(&n->seq, FUTEX_WAIT_PRIVATE, seq, NULL);   /* EAGAIN/EINTR: check again */
+        }
+        atomic_fetch_sub(&n->waiters, 1);
+    }
+
+    if (time != NULL) {
+        uint64_t ns = atomic_load_explicit(&n->time_ns, memory_order_relaxed);
+        time->tv_sec = ns / NS_IN_SEC;
+        time->tv_nsec = ns % NS_IN_SEC;
+    }
+    return seq;
+}
+
+int notifyWaitUntil(rtNotify *n, unsigned last, const struct timespec *limit) {
+    int published = 1;
+
+    atomic_fetch_add(&n->waiters, 1);
+    while (atomic_load(&n->seq) == last && !atomic_load(&n->closed)) {
+        /* FUTEX_WAIT_BITSET: absolute CLOCK_MONOTONIC time limit */
+        if (futex(&n->seq, FUTEX_WAIT_BITSET_PRIVATE, last, limit) != 0 && errno == ETIMEDOUT) {
+            published = (atomic_load(&n->seq) != last);
+            break;
+        }
+    }
+    atomic_fetch_sub(&n->waiters, 1);
+    return published;
+}
@@ -0,0 +1,75 @@
+/* ************************************************************
+ * Publish/subscribe notification
+ *
+ * A publication counter that subscribers can block on: the writer of
+ * a shared buffer (e.g. a CAB) calls notifyPublish after each new
+ * message, and every subscriber waiting for it is woken. Subscribers
+ * keep the count they last handled, so they can wait for the next
+ * publication, or for every n-th one, and see how many they missed;
+ * nothing accumulates (unlike a semaphore, a late subscriber does not
+ * get a burst of wake-ups for messages already overwritten).
+ *
+ * The counter is a futex word (Linux): publishing is one atomic
+ * increment, plus one FUTEX_WAKE system call only when a subscriber
+ * is blocked, so it can be done from the audio callback.
+ * ************************************************************/
+
+#ifndef _NOTIFY_H
+#define _NOTIFY_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <time.h>
+
+typedef struct {
+    atomic_uint seq;            /* Publications so far (futex word) */
+    atomic_int waiters;         /* Subscribers blocked (or about to) */
+    atomic_int closed;          /* No more publications: waits return at once */
+    _Atomic uint64_t time_ns;   /* CLOCK_MONOTONIC of the last publication */
+} rtNotify;
+
+/* *******************************************************************
+ * Initializes a notification (no publication yet)
+ * *******************************************************************/
+void notifyInit(rtNotify *n);
+
+/* *******************************************************************
+ * Publisher: counts a publication and wakes all the subscribers
+ * Only one thread may publish on a given notification
+ * *******************************************************************/
+void notifyPublish(rtNotify *n);
+
+/* *******************************************************************
+ * Ends the notification (e.g. at shutdown, from any thread): wakes all
+ * the subscribers, and notifyWait/notifyWaitUntil no longer block
+ * *******************************************************************/
+void notifyClose(rtNotify *n);
+
+/* *******************************************************************
+ * Number of publications so far (a subscriber's starting point)
+ * *******************************************************************/
+unsigned notifySeq(rtNotify *n);
+
+/* *******************************************************************
+ * Subscriber: blocks until count publications have been made since
+ * the one numbered last
+ * Args are:
+ * 		rtNotify *n: notification
+ * 		unsigned last: count at the previous wake-up (notifySeq at start)
+ * 		unsigned count: publications to wait for (>= 1)
+ * 		struct timespec *time: if not NULL, set to the time of the latest
+ *                    publication
+ * Returns the current count (> last + count - 1 if some were missed),
+ * at once if the notification is closed
+ * *******************************************************************/
+unsigned notifyWait(rtNotify *n, unsigned last, unsigned count, struct timespec *time);
+
+/* *******************************************************************
+ * Subscriber: blocks until a publication after the one numbered last,
+ * or until an absolute CLOCK_MONOTONIC time (a periodic release that
+ * can be cut short)
+ * Returns 1 if published (or closed), 0 at the time limit
+ * *******************************************************************/
+int notifyWaitUntil(rtNotify *n, unsigned last, const struct timespec *limit);
+
+#endif
@@ -0,0 +1,197 @@
+/* ************************************************************
+ * Status renderer: frames formatted once, written in the background
+ *
+ * Each panel is a CAB of RENDER_SLOTS frames with one writer (its
+ * task) and one reader (the writer thread), so a free slot always
+ * exists. The thread tells a new frame by its seq, set before the
+ * publish, and holds one slot of every panel while it composes the
+ * screen.
+ * ************************************************************/
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/ioctl.h>
+#include "cab.h"
+#include "render.h"
+
+#define ANSI_BEGIN "\x1b[?7l\x1b[H"    /* No line wrap, cursor home */
+#define ANSI_EOL "\x1b[K\n"             /* Clear to end of line */
+#define ANSI_END "\x1b[J\x1b[?7h"       /* Clear to end of screen, line wrap */
+#define SCREEN_BYTES (RENDER_MAX_PANELS * RENDER_FRAME_BYTES * 2)
+
+typedef struct {
+    renderFrame frame[RENDER_SLOTS];
+    cabCtrl cab;
+    unsigned published;         /* Frames published (task) */
+    unsigned taken;             /* seq of the last frame written (writer) */
+} renderPanel;
+
+static renderPanel panels[RENDER_MAX_PANELS];
+static atomic_int npanels;
+
+static char screen[SCREEN_BYTES];   /* Redraw of all the panels (writer) */
+static int logFd = -1;
+static int redraw;                  /* stdout is a terminal */
+static unsigned skipped;
+static pthread_t writer;
+static atomic_int running;
+static int writePeriodMs;
+
+int renderRegister(void) {
+    int id = atomic_load(&npanels);
+
+    if (id >= RENDER_MAX_PANELS) return -1;
+    cabCtrl_init(&panels[id].cab, RENDER_SLOTS);  /* Slot 0: empty frame, seq 0 */
+    atomic_store(&npanels, id + 1);
+    return id;
+}
+
+renderFrame *renderBegin(int panel) {
+    if (panel < 0 || panel >= atomic_load(&npanels)) return NULL;
+
+    int slot = cabCtrl_getWriteSlot(&panels[panel].cab);
+    if (slot < 0) return NULL;  /* Not with a single reader */
+    renderFrame *f = &panels[panel].frame[slot];
+    f->len = 0;
+    f->text[0] = '\0';
+    return f;
+}
+
+void renderf(renderFrame *f, const char *fmt, ...) {
+    size_t room = sizeof(f->text) - f->len;
+    va_list ap;
+
+    va_start(ap, fmt);
+    int n = vsnprintf(f->text + f->len, room, fmt, ap);
+    va_end(ap);
+    if (n > 0) f->len += ((size_t)n < room) ? (size_t)n : room - 1;
+}
+
+void renderWith(renderFrame *f, size_t (*format)(char *buf, size_t size)) {
+    size_t room = sizeof(f->text) - f->len;
+    size_t n = format(f->text + f->len, room);
+
+    f->len += (n < room) ? n : room - 1;
+}
+
+void renderPublish(int panel, renderFrame *f) {
+    renderPanel *p = &panels[panel];
+
+    f->seq = ++p->published;
+    cabCtrl_publish(&p->cab, (int)(f - p->frame));
+}
+
+/* Writes all of buf (short writes, signals) */
+static void writeAll(int fd, const char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, buf, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        buf += n;
+        len -= n;
+    }
+}
+
+/* Appends a frame to the screen, each line cleared to its end, up to
+ * *rows lines (the terminal height) */
+static size_t screenAppend(size_t at, const renderFrame *f, int *rows) {
+    for (size_t i = 0; i < f->len && *rows > 0; i++) {
+        if (at + sizeof(ANSI_EOL) + sizeof(ANSI_END) > SCREEN_BYTES) break;
+        if (f->text[i] == '\n') {
+            memcpy(screen + at, ANSI_EOL, sizeof(ANSI_EOL) - 1);
+            at += sizeof(ANSI_EOL) - 1;
+            (*rows)--;
+        } else {
+            screen[at++] = f->text[i];
+        }
+    }
+    return at;
+}
+
+/* Writes the new frames of every panel (writer thread only) */
+static void renderFlush(void) {
+    int n = atomic_load(&npanels);
+    int slot[RENDER_MAX_PANELS];
+    int fresh = 0;
+
+    for (int i = 0; i < n; i++) {
+        renderPanel *p = &panels[i];
+        slot[i] = cabCtrl_getReadSlot(&p->cab);
+        const renderFrame *f = &p->frame[slot[i]];
+        if (f->seq == p->taken) continue;
+
+        skipped += f->seq - p->taken - 1;
+        p->taken = f->seq;
+        fresh = 1;
+        if (logFd >= 0) writeAll(logFd, f->text, f->len);
+        if (!redraw) writeAll(STDOUT_FILENO, f->text, f->len);
+    }
+
+    if (fresh && redraw) {
+        struct winsize ws;
+        int rows = (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_row > 1) ? ws.ws_row - 1 : 24;
+        size_t at = sizeof(ANSI_BEGIN) - 1;
+
+        memcpy(screen, ANSI_BEGIN, at);
+        for (int i = 0; i < n; i++) {
+            at = screenAppend(at, &panels[i].frame[slot[i]], &rows);
+        }
+        memcpy(screen + at, ANSI_END, sizeof(ANSI_END) - 1);
+        writeAll(STDOUT_FILENO, screen, at + sizeof(ANSI_END) - 1);
+    }
+
+    for (int i = 0; i < n; i++) cabCtrl_release(&panels[i].cab, slot[i]);
+}
+
+static void *renderWriter(void *arg) {
+    struct timespec period = { writePeriodMs / 1000, (writePeriodMs % 1000) * 1000000L };
+
+    (void)arg;
+    while (atomic_load(&running)) {
+        renderFlush();
+        while (nanosleep(&period, &period) != 0 && errno == EINTR);
+        period.tv_sec = writePeriodMs / 1000;
+        period.tv_nsec = (writePeriodMs % 1000) * 1000000L;
+    }
+    return NULL;
+}
+
+int renderStart(const char *logPath, int periodMs) {
+    if (logPath != NULL) {
+        logFd = open(logPath, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (logFd < 0) return -1;
+    }
+    redraw = isatty(STDOUT_FILENO);
+    fflush(stdout);  /* What is printed before goes first */
+
+    writePeriodMs = (periodMs > 0) ? periodMs : 1;
+    atomic_store(&running, 1);
+    int err = pthread_create(&writer, NULL, renderWriter, NULL);
+    if (err != 0) {
+        atomic_store(&running, 0);
+        if (logFd >= 0) close(logFd);
+        logFd = -1;
+        errno = err;
+        return -1;
+    }
+    return 0;
+}
+
+unsigned renderStop(void) {
+    if (!atomic_load(&running)) return 0;
+
+    atomic_store(&running, 0);
+    pthread_join(writer, NULL);
+    renderFlush();
+    if (logFd >= 0) close(logFd);
+    logFd = -1;
+    return skipped;
+}
@@ -0,0 +1,84 @@
+/* ************************************************************
+ * Status renderer: frames formatted once, written in the background
+ *
+ * A reporting task (Display, FFT) formats its status text into a frame
+ * of its panel, a preallocated buffer, with renderf: no I/O, no
+ * allocation, no lock. Its frames are the slots of a CAB (rt/cab.h):
+ * publishing one never waits for the writer, and a frame the writer
+ * has not taken yet is replaced by the newer one.
+ *
+ * A low-priority writer thread polls the panels and, for each new
+ * frame:
+ *   - appends it to the log file with one write() (the file is opened
+ *     once, O_APPEND);
+ *   - on a terminal, redraws all the panels in place with one write():
+ *     cursor home, the latest frame of each panel in order, each line
+ *     cleared to its end, the rest of the screen cleared (ANSI), cut
+ *     to the terminal height. Elsewhere (pipe, file) the frame is
+ *     written as is, after the previous ones.
+ * A slow terminal or disk only delays the writer, never the tasks.
+ * ************************************************************/
+
+#ifndef _RENDER_H
+#define _RENDER_H
+
+#include <stddef.h>
+
+#define RENDER_MAX_PANELS 4
+#define RENDER_FRAME_BYTES 8192     /* Text of one frame, '\0' included */
+#define RENDER_SLOTS 3              /* Being formatted, latest, being written */
+
+typedef struct {
+    char text[RENDER_FRAME_BYTES];
+    size_t len;                     /* Bytes of text (without the '\0') */
+    unsigned seq;                   /* Frames published on the panel, this one included */
+} renderFrame;
+
+/* *******************************************************************
+ * Adds a panel, drawn below the ones added before it
+ * Returns the panel id, or -1 if RENDER_MAX_PANELS are added
+ * Call from main, before renderStart
+ * *******************************************************************/
+int renderRegister(void);
+
+/* *******************************************************************
+ * Gets an empty frame of a panel to format
+ * Returns the frame, or NULL if panel is not a registered panel
+ * Only one thread may render a given panel
+ * *******************************************************************/
+renderFrame *renderBegin(int panel);
+
+/* *******************************************************************
+ * Appends printf-formatted text to a frame (cut if it does not fit)
+ * *******************************************************************/
+void renderf(renderFrame *f, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+/* *******************************************************************
+ * Appends the text of a formatter with snprintf semantics
+ * (e.g. statsFormat)
+ * *******************************************************************/
+void renderWith(renderFrame *f, size_t (*format)(char *buf, size_t size));
+
+/* *******************************************************************
+ * Makes a frame from renderBegin the latest one of its panel
+ * *******************************************************************/
+void renderPublish(int panel, renderFrame *f);
+
+/* *******************************************************************
+ * Opens the log file (appending) and starts the writer thread
+ * Args are:
+ * 		const char *logPath: log file (NULL: terminal only)
+ * 		int periodMs: period of the writer
+ * Redraws in place if stdout is a terminal
+ * Returns 0, or -1 (errno set) if the file cannot be opened or the
+ * thread created
+ * *******************************************************************/
+int renderStart(const char *logPath, int periodMs);
+
+/* *******************************************************************
+ * Stops the writer, writes the frames still pending, closes the log
+ * Returns the frames replaced before the writer took them (not logged)
+ * *******************************************************************/
+unsigned renderStop(void);
+
+#endif
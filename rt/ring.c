@@ -0,0 +1,118 @@
+/* ************************************************************
+ * Sample ring: lock-free single producer, single consumer
+ *
+ * The producer stores the samples and the mark of the write, then
+ * head (release); the consumer reads head (acquire) before the samples
+ * and the marks below it. The consumer stores tail (release) once it
+ * no longer needs the samples, and the producer reads it (acquire)
+ * before reusing their place.
+ *
+ * The marks are read by other threads too, and the producer replaces
+ * the oldest one with each write: a seqlock per mark, whose count also
+ * tells which write it holds, so a reader skips a mark that is being
+ * replaced or that was replaced since it read writes.
+ * ************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include "ring.h"
+
+#define NS_IN_SEC 1000000000L
+
+int ringInit(sampleRing *r, uint32_t size) {
+    if (size < 2 || (size & (size - 1)) != 0) return -1;
+
+    r->buf = calloc(size, sizeof(uint16_t));
+    if (r->buf == NULL) return -1;
+    r->size = size;
+    atomic_init(&r->head, 0);
+    atomic_init(&r->tail, 0);
+    atomic_init(&r->dropped, 0);
+    atomic_init(&r->writes, 0);
+    for (int i = 0; i < RING_MARKS; i++) {
+        atomic_init(&r->marks[i].seq, 0);
+        atomic_init(&r->marks[i].end, 0);
+        atomic_init(&r->marks[i].time_ns, 0);
+    }
+    notifyInit(&r->notify);
+    return 0;
+}
+
+void ringDestroy(sampleRing *r) {
+    free(r->buf);
+    r->buf = NULL;
+}
+
+int ringWrite(sampleRing *r, const uint16_t *x, int n, const struct timespec *t) {
+    uint64_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    uint64_t tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+    uint64_t room = r->size - (head - tail);
+
+    if ((uint64_t)n > room) {
+        atomic_fetch_add_explicit(&r->dropped, n - room, memory_order_relaxed);
+        n = (int)room;
+    }
+
+    /* Two copies when the period wraps around the end of the ring */
+    uint32_t start = (uint32_t)head & (r->size - 1);
+    int first = (r->size - start < (uint32_t)n) ? (int)(r->size - start) : n;
+    memcpy(r->buf + start, x, first * sizeof(uint16_t));
+    memcpy(r->buf, x + first, (n - first) * sizeof(uint16_t));
+
+    unsigned w = atomic_load_explicit(&r->writes, memory_order_relaxed);
+    ringMark *m = &r->marks[w % RING_MARKS];
+    atomic_store_explicit(&m->seq, 2 * w + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&m->end, head + n, memory_order_relaxed);
+    atomic_store_explicit(&m->time_ns, (uint64_t)t->tv_sec * NS_IN_SEC + t->tv_nsec, memory_order_relaxed);
+    atomic_store_explicit(&m->seq, 2 * w + 2, memory_order_release);
+    atomic_store_explicit(&r->writes, w + 1, memory_order_release);
+
+    atomic_store_explicit(&r->head, head + n, memory_order_release);
+    notifyPublish(&r->notify);
+    return n;
+}
+
+uint64_t ringHead(sampleRing *r) {
+    return atomic_load_explicit(&r->head, memory_order_acquire);
+}
+
+void ringRead(sampleRing *r, uint64_t from, uint16_t *x, int n) {
+    uint32_t start = (uint32_t)from & (r->size - 1);
+    int first = (r->size - start < (uint32_t)n) ? (int)(r->size - start) : n;
+
+    memcpy(x, r->buf + start, first * sizeof(uint16_t));
+    memcpy(x + first, r->buf, (n - first) * sizeof(uint16_t));
+}
+
+void ringRelease(sampleRing *r, uint64_t to) {
+    atomic_store_explicit(&r->tail, to, memory_order_release);
+}
+
+int ringTime(sampleRing *r, uint64_t sample, struct timespec *t) {
+    unsigned w = atomic_load_explicit(&r->writes, memory_order_acquire);
+    int kept = (w < RING_MARKS) ? (int)w : RING_MARKS;
+    uint64_t ns = 0;
+    int found = 0;
+
+    /* Newest to oldest: the last one that ends after the sample brought
+     * it. A mark that no longer holds write w - i (being replaced by a
+     * newer write) ends the search, as the older ones would */
+    for (int i = 1; i <= kept; i++) {
+        ringMark *m = &r->marks[(w - i) % RING_MARKS];
+        unsigned expect = 2 * (w - i) + 2;
+        if (atomic_load_explicit(&m->seq, memory_order_acquire) != expect) break;
+        uint64_t end = atomic_load_explicit(&m->end, memory_order_relaxed);
+        uint64_t t_ns = atomic_load_explicit(&m->time_ns, memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&m->seq, memory_order_relaxed) != expect) break;
+
+        if (end <= sample) break;
+        ns = t_ns;
+        found = 1;
+    }
+    if (!found) return -1;
+    t->tv_sec = (time_t)(ns / NS_IN_SEC);
+    t->tv_nsec = (long)(ns % NS_IN_SEC);
+    return 0;
+}
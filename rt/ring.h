@@ -0,0 +1,95 @@
+/* ************************************************************
+ * Sample ring: lock-free single producer, single consumer
+ *
+ * The capture callback appends each period of samples as it arrives,
+ * whatever its size, and a consumer cuts frames of any size and hop
+ * from it: the capture period and the analysis frame are independent.
+ * Samples are addressed by their offset in the stream (head: samples
+ * written so far), so a consumer can read overlapped frames and
+ * release only the samples no later frame needs.
+ *
+ * Each write records its capture time, so the time a given sample
+ * arrived can be found later (the last RING_MARKS writes are kept),
+ * also by other threads than the consumer.
+ * The indices are C11 atomics and a write never blocks nor allocates:
+ * it can be done from the audio callback. Memory is allocated by
+ * ringInit() only, before the real-time loop.
+ * ************************************************************/
+
+#ifndef _RING_H
+#define _RING_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+#include <time.h>
+#include "notify.h"
+
+#define RING_MARKS 64               /* Capture times kept (writes) */
+
+typedef struct {
+    atomic_uint seq;            /* 2w + 2 once write w is stored, odd while it is stored */
+    _Atomic uint64_t end;       /* Stream offset after the write */
+    _Atomic uint64_t time_ns;   /* Its capture time (CLOCK_MONOTONIC) */
+} ringMark;
+
+typedef struct {
+    uint16_t *buf;
+    uint32_t size;              /* Capacity (power of 2) */
+    _Atomic uint64_t head;      /* Samples written (producer) */
+    _Atomic uint64_t tail;      /* Samples released (consumer) */
+    _Atomic uint64_t dropped;   /* Samples dropped because the ring was full */
+    atomic_uint writes;         /* Writes so far (marks[writes % RING_MARKS] is next) */
+    ringMark marks[RING_MARKS];
+    rtNotify notify;            /* Published with each write (wakes the consumer) */
+} sampleRing;
+
+/* *******************************************************************
+ * Allocates the ring (empty, no publication yet)
+ * Args are:
+ * 		sampleRing *r: the ring
+ * 		uint32_t size: capacity in samples. *** MUST BE A POWER OF 2 ****
+ *                    Must hold a frame plus the samples that arrive
+ *                    between two consumer runs
+ * Returns 0, or -1 if size is invalid or memory is exhausted
+ * *******************************************************************/
+int ringInit(sampleRing *r, uint32_t size);
+
+/* *******************************************************************
+ * Releases the memory held by the ring
+ * *******************************************************************/
+void ringDestroy(sampleRing *r);
+
+/* *******************************************************************
+ * Producer: appends n samples captured at time t, then publishes
+ * r->notify
+ * Returns the number of samples stored (< n if the ring is full; the
+ * others are counted in r->dropped)
+ * *******************************************************************/
+int ringWrite(sampleRing *r, const uint16_t *x, int n, const struct timespec *t);
+
+/* *******************************************************************
+ * Consumer: samples written so far (stream offset of the next one)
+ * *******************************************************************/
+uint64_t ringHead(sampleRing *r);
+
+/* *******************************************************************
+ * Consumer: copies n samples from stream offset from. They must have
+ * been written and not released (tail <= from, from + n <= head)
+ * *******************************************************************/
+void ringRead(sampleRing *r, uint64_t from, uint16_t *x, int n);
+
+/* *******************************************************************
+ * Consumer: releases the samples before stream offset to (the
+ * producer may overwrite them)
+ * *******************************************************************/
+void ringRelease(sampleRing *r, uint64_t to);
+
+/* *******************************************************************
+ * Any thread: capture time of the write that brought the sample at
+ * stream offset sample (the oldest one kept if it is older). A mark
+ * the producer is replacing meanwhile is not used
+ * Returns 0, or -1 if the sample has not been written
+ * *******************************************************************/
+int ringTime(sampleRing *r, uint64_t sample, struct timespec *t);
+
+#endif
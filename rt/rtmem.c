@@ -0,0 +1,94 @@
+/* ************************************************************
+ * Memory preparation for real-time execution
+ * ************************************************************/
+
+#define _GNU_SOURCE             /* pthread_setattr_default_np */
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <malloc.h>
+#include <alloca.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include "rtmem.h"
+
+int rtMemLock(size_t stackSize) {
+    /* Freed memory stays in the heap, and large blocks come from it
+     * too: once touched and locked, heap pages are never given back */
+    mallopt(M_TRIM_THRESHOLD, -1);
+    mallopt(M_MMAP_MAX, 0);
+
+    if (stackSize > 0) {
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        pthread_attr_setstacksize(&attr, stackSize);
+        pthread_setattr_default_np(&attr);
+        pthread_attr_destroy(&attr);
+    }
+
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) return errno;
+    return 0;
+}
+
+/* Not inlined, so that the array is below the caller's frame */
+__attribute__((noinline)) void rtMemPrefaultStack(size_t bytes) {
+    volatile uint8_t *stack = alloca(bytes);
+
+    for (size_t i = 0; i < bytes; i += 4096) stack[i] = 0;
+}
+
+int rtArenaInit(rtArena *a, size_t size) {
+    memset(a, 0, sizeof(*a));
+    size = (size + RTMEM_ALIGN - 1) & ~(size_t)(RTMEM_ALIGN - 1);
+    if (posix_memalign((void **)&a->base, RTMEM_ALIGN, size) != 0) {
+        a->base = NULL;
+        return -1;
+    }
+    memset(a->base, 0, size);   /* Touches every page */
+    a->size = size;
+    return 0;
+}
+
+void *rtArenaAlloc(rtArena *a, size_t size, const char *name) {
+    size = (size + RTMEM_ALIGN - 1) & ~(size_t)(RTMEM_ALIGN - 1);
+    if (a->base == NULL || size > a->size - a->used) return NULL;
+
+    void *p = a->base + a->used;
+    a->used += size;
+    if (a->nblocks < RTMEM_MAX_BLOCKS) {
+        strncpy(a->blocks[a->nblocks].name, name, RTMEM_NAME_LEN - 1);
+        a->blocks[a->nblocks].name[RTMEM_NAME_LEN - 1] = '\0';
+        a->blocks[a->nblocks].size = size;
+        a->nblocks++;
+    }
+    return p;
+}
+
+void rtMemReport(FILE *f, const rtArena *a) {
+    char line[128];
+    size_t stack = 0;
+    pthread_attr_t attr;
+
+    if (pthread_getattr_default_np(&attr) == 0) {
+        pthread_attr_getstacksize(&attr, &stack);
+        pthread_attr_destroy(&attr);
+    }
+
+    fprintf(f, "Real-time memory:\n");
+    if (a != NULL) {
+        fprintf(f, " arena %zu of %zu KB used\n", a->used / 1024, a->size / 1024);
+        for (int i = 0; i < a->nblocks; i++) {
+            fprintf(f, "   %-22s %8zu KB\n", a->blocks[i].name, a->blocks[i].size / 1024);
+        }
+    }
+    fprintf(f, " default thread stack %zu KB\n", stack / 1024);
+
+    FILE *status = fopen("/proc/self/status", "r");
+    if (status == NULL) return;
+    while (fgets(line, sizeof(line), status) != NULL) {
+        if (strncmp(line, "VmRSS:", 6) == 0 || strncmp(line, "VmLck:", 6) == 0) {
+            fprintf(f, " %s", line);
+        }
+    }
+    fclose(status);
+}
@@ -0,0 +1,73 @@
+/* ************************************************************
+ * Memory preparation for real-time execution
+ *
+ * A page touched for the first time inside a job costs a page fault
+ * (and possibly I/O): the memory used by the tasks is made resident
+ * before the first release instead.
+ *    - rtMemLock locks all the pages of the process, present and
+ *      future (mlockall), keeps freed heap memory in the process
+ *      (no trim, no mmap'ed chunks) and makes the default thread
+ *      stack small, since a locked stack is entirely resident
+ *    - rtArena is a fixed block, allocated and touched once at
+ *      startup, from which the task states (scratch buffers) are
+ *      taken: bump allocation, never freed
+ *    - rtMemPrefaultStack touches the stack of the calling thread
+ * ************************************************************/
+
+#ifndef _RTMEM_H
+#define _RTMEM_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define RTMEM_ALIGN 64              /* Arena blocks: cache line (and AVX) aligned */
+#define RTMEM_MAX_BLOCKS 32         /* Named blocks listed by rtMemReport */
+#define RTMEM_NAME_LEN 24
+
+typedef struct {
+    uint8_t *base;
+    size_t size;
+    size_t used;
+    int nblocks;
+    struct {
+        char name[RTMEM_NAME_LEN];
+        size_t size;
+    } blocks[RTMEM_MAX_BLOCKS];
+} rtArena;
+
+/* *******************************************************************
+ * Locks the memory of the process and sets the default thread stack
+ * Args are:
+ * 		size_t stackSize: default stack of the threads created from now
+ *                    on without an explicit size (0: unchanged)
+ * Returns 0, or the error number of mlockall (e.g. EPERM without
+ * CAP_IPC_LOCK): the program can go on, with page faults
+ * *******************************************************************/
+int rtMemLock(size_t stackSize);
+
+/* *******************************************************************
+ * Touches bytes of stack below the caller, so that they are resident
+ * *******************************************************************/
+void rtMemPrefaultStack(size_t bytes);
+
+/* *******************************************************************
+ * Allocates and touches an arena of size bytes
+ * Returns 0, or -1 if it cannot be allocated
+ * *******************************************************************/
+int rtArenaInit(rtArena *a, size_t size);
+
+/* *******************************************************************
+ * Takes a zeroed block of size bytes (RTMEM_ALIGN aligned) from the
+ * arena, named for the report
+ * Returns the block, or NULL if the arena is full
+ * *******************************************************************/
+void *rtArenaAlloc(rtArena *a, size_t size, const char *name);
+
+/* *******************************************************************
+ * Prints the blocks of the arena and the memory the process has
+ * resident and locked (VmRSS, VmLck)
+ * *******************************************************************/
+void rtMemReport(FILE *f, const rtArena *a);
+
+#endif
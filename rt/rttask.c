@@ -0,0 +1,266 @@
+/* ************************************************************
+ * Real-time tasks
+ * ************************************************************/
+
+#define _GNU_SOURCE             /* pthread_attr_setaffinity_np, CPU_SET */
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <unistd.h>
+#include "rttask.h"
+#include "trace.h"
+#include "stats.h"
+
+#define NS_IN_SEC 1000000000L
+
+static struct timespec startTime;     /* Common origin of the offsets */
+static rtNotify stopEvent;            /* Closed by rtTaskStop */
+static rtNotify goEvent;              /* Published once every thread is ready */
+static atomic_int readyThreads;       /* Initialized (or failed), waiting for goEvent */
+static atomic_int failedThreads;      /* Whose init failed */
+
+static struct timespec tsAddNs(struct timespec t, int64_t ns) {
+    ns += t.tv_nsec;
+    t.tv_sec += ns / NS_IN_SEC;
+    t.tv_nsec = ns % NS_IN_SEC;
+    return t;
+}
+
+static int tsBefore(const struct timespec *a, const struct timespec *b) {
+    return a->tv_sec < b->tv_sec || (a->tv_sec == b->tv_sec && a->tv_nsec < b->tv_nsec);
+}
+
+static size_t stackBytes(const rtTask *t) {
+    return (size_t)((t->stackKb > 0) ? t->stackKb : RTTASK_STACK_KB) * 1024;
+}
+
+/* 0 if the process may run on cpu (online, in its affinity mask),
+ * else the error number */
+static int cpuAllowed(int cpu) {
+    cpu_set_t set;
+
+    if (cpu >= CPU_SETSIZE) return EINVAL;
+    if (sched_getaffinity(0, sizeof(set), &set) != 0) return errno;
+    return CPU_ISSET(cpu, &set) ? 0 : EINVAL;
+}
+
+static void *rtTaskThread(void *arg) {
+    rtTask *t = arg;
+    const int64_t period = (int64_t)t->periodMs * 1000000;
+    const struct timespec periodTs = tsAddNs((struct timespec){0, 0}, period);
+    const struct timespec deadlineTs = tsAddNs((struct timespec){0, 0},
+                                               (int64_t)t->deadlineMs * 1000000);
+    struct timespec next;
+    const unsigned every = (t->every > 0) ? t->every : 1;
+
+    if (t->event != NULL) {
+        printf("%s running - prio %d, every %u publication(s)\n", t->name, t->prio, every);
+    } else {
+        printf("%s running - prio %d, period %d ms\n", t->name, t->prio, t->periodMs);
+    }
+    rtMemPrefaultStack(stackBytes(t) - RTTASK_STACK_MARGIN_KB * 1024);
+    t->traceId = traceRegister(t->name, t->prio);
+    t->statsId = statsRegister(t->name, t->prio, &periodTs, (t->deadlineMs > 0) ? &deadlineTs : NULL);
+
+    if (t->init != NULL && t->init(t) != 0) {
+        fprintf(stderr, "%s: initialization failed, task not started\n", t->name);
+        atomic_fetch_add(&failedThreads, 1);
+        atomic_fetch_add(&readyThreads, 1);
+        return NULL;
+    }
+
+    /* Publications before the first job are not handled; no task is
+     * released before all of them are waiting (startTime is set then) */
+    if (t->event != NULL) t->eventSeq = notifySeq(t->event);
+    atomic_fetch_add(&readyThreads, 1);
+    notifyWait(&goEvent, 0, 1, NULL);
+    next = tsAddNs(startTime, (int64_t)t->offsetMs * 1000000);
+
+    while (1) {
+        struct timespec start, end;
+
+        if (t->event != NULL) {
+            unsigned seq = notifyWait(t->event, t->eventSeq, every, &t->release);
+            if (atomic_load(&stopEvent.closed)) break;
+            t->skipped += (seq - t->eventSeq) / every - 1;
+            t->eventSeq = seq;
+        } else {
+            if (notifyWaitUntil(&stopEvent, 0, &next)) break;   /* Stopped before the release */
+            t->release = next;
+            next = tsAddNs(next, period);
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        t->block = 0;
+        int idle = t->body(t);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        traceEvent(t->traceId, &start, &end, t->block);
+        if (idle != RTTASK_IDLE) statsJob(t->statsId, &t->release, &start, &end);
+        t->jobs++;
+        notifyPublish(&t->done);
+
+        /* Overrun: skip the releases that are already past, the next
+         * one (at most one period ago) is served at once */
+        if (t->event == NULL && period > 0) {
+            struct timespec catchUp = tsAddNs(next, period);
+            while (!tsBefore(&end, &catchUp)) {
+                next = catchUp;
+                catchUp = tsAddNs(catchUp, period);
+                t->skipped++;
+            }
+        }
+    }
+    return NULL;
+}
+
+int rtTaskStart(rtTask *tasks, int n, long startDelayNs, rtArena *arena) {
+    notifyInit(&stopEvent);
+    notifyInit(&goEvent);
+    atomic_store(&readyThreads, 0);
+    atomic_store(&failedThreads, 0);
+
+    for (int i = 0; i < n; i++) {
+        rtTask *t = &tasks[i];
+        struct sched_param parm = { .sched_priority = t->prio };
+        pthread_attr_t attr;
+
+        t->jobs = 0;
+        t->skipped = 0;
+        t->traceId = -1;
+        t->statsId = -1;
+        t->started = 0;
+        t->ctx = NULL;
+        notifyInit(&t->done);
+        if (t->ctxSize > 0 && (t->ctx = rtArenaAlloc(arena, t->ctxSize, t->name)) == NULL) {
+            fprintf(stderr, "Task %s: state of %zu bytes does not fit in the arena\n", t->name, t->ctxSize);
+            rtTaskStop(tasks, i);  /* The threads created wait for goEvent */
+            return -1;
+        }
+
+        pthread_attr_init(&attr);
+        pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+        pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+        pthread_attr_setschedparam(&attr, &parm);
+        pthread_attr_setstacksize(&attr, stackBytes(t));
+        if (t->cpu >= 0) {
+            int err = cpuAllowed(t->cpu);
+            if (err == 0) {
+                cpu_set_t set;
+                CPU_ZERO(&set);
+                CPU_SET(t->cpu, &set);
+                err = pthread_attr_setaffinity_np(&attr, sizeof(set), &set);
+            }
+            if (err != 0) {
+                fprintf(stderr, "Task %s: cannot run on CPU %d [%s]\n", t->name, t->cpu, strerror(err));
+                pthread_attr_destroy(&attr);
+                rtTaskStop(tasks, i);
+                return -1;
+            }
+        }
+
+        int err = pthread_create(&t->thread, &attr, rtTaskThread, t);
+        pthread_attr_destroy(&attr);
+        if (err != 0) {
+            fprintf(stderr, "Error creating thread %s [%s]\n", t->name, strerror(err));
+            rtTaskStop(tasks, i);
+            return -1;
+        }
+        t->started = 1;
+    }
+
+    /* Every thread initialized and subscribed: common start */
+    while (atomic_load(&readyThreads) < n) {
+        struct timespec poll = { 0, 1000000 };
+        nanosleep(&poll, NULL);
+    }
+    if (atomic_load(&failedThreads) > 0) {  /* No job is run: the others end at once */
+        rtTaskStop(tasks, n);
+        return -1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &startTime);
+    startTime = tsAddNs(startTime, startDelayNs);
+    notifyPublish(&goEvent);
+    return 0;
+}
+
+void rtTaskStop(rtTask *tasks, int n) {
+    notifyClose(&stopEvent);
+    notifyClose(&goEvent);
+    for (int i = 0; i < n; i++) {
+        if (!tasks[i].started) continue;
+        if (tasks[i].event != NULL) notifyClose(tasks[i].event);
+        notifyClose(&tasks[i].done);
+    }
+    for (int i = 0; i < n; i++) {
+        if (!tasks[i].started) continue;
+        pthread_join(tasks[i].thread, NULL);
+        tasks[i].started = 0;
+    }
+}
+
+int rtPlaceThread(int prio, int cpu) {
+    int err;
+
+    if (prio > 0) {
+        struct sched_param parm = { .sched_priority = prio };
+        err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &parm);
+        if (err != 0) return err;
+    }
+    if (cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (err != 0) return err;
+    }
+    return 0;
+}
+
+void rtPrintPlacement(FILE *f, const char *name, pthread_t thread) {
+    struct sched_param parm;
+    cpu_set_t set;
+    int policy;
+    char cpus[256];
+    int len = 0;
+    size_t stack = 0;
+    pthread_attr_t attr;
+
+    if (pthread_getschedparam(thread, &policy, &parm) != 0
+        || pthread_getaffinity_np(thread, sizeof(set), &set) != 0) {
+        fprintf(f, " %-18s (not running)\n", name);
+        return;
+    }
+
+    if (pthread_getattr_np(thread, &attr) == 0) {
+        pthread_attr_getstacksize(&attr, &stack);
+        pthread_attr_destroy(&attr);
+    }
+
+    /* Allowed CPUs as ranges, e.g. "0-3,6" */
+    cpus[0] = '\0';
+    for (int c = 0; c < CPU_SETSIZE && len < (int)sizeof(cpus) - 16; c++) {
+        if (!CPU_ISSET(c, &set)) continue;
+        int last = c;
+        while (last + 1 < CPU_SETSIZE && CPU_ISSET(last + 1, &set)) last++;
+        const char *sep = (len > 0) ? "," : "";
+        if (last > c) {
+            len += snprintf(cpus + len, sizeof(cpus) - len, "%s%d-%d", sep, c, last);
+        } else {
+            len += snprintf(cpus + len, sizeof(cpus) - len, "%s%d", sep, c);
+        }
+        c = last;
+    }
+
+    fprintf(f, " %-18s %-11s prio %2d  stack %5zu KB  CPUs %s\n", name,
+            (policy == SCHED_FIFO) ? "SCHED_FIFO" : (policy == SCHED_RR) ? "SCHED_RR" : "SCHED_OTHER",
+            parm.sched_priority, stack / 1024, cpus);
+}
+
+void rtTaskReport(FILE *f, const rtTask *tasks, int n) {
+    fprintf(f, "Thread placement (%ld CPUs online):\n", sysconf(_SC_NPROCESSORS_ONLN));
+    for (int i = 0; i < n; i++) {
+        rtPrintPlacement(f, tasks[i].name, tasks[i].thread);
+    }
+}
@@ -0,0 +1,129 @@
+/* ************************************************************
+ * Real-time tasks
+ *
+ * A task is one entry of a table: name, timing (period, offset,
+ * deadline), SCHED_FIFO priority, CPU, the code of one job and the size
+ * of its state. The states are taken from an arena (rt/rtmem.h) and the
+ * thread stacks are sized and touched before the first job, so that
+ * jobs do not page-fault on first use of their memory.
+ * rtTaskStart creates one thread per entry, which releases the jobs
+ * at absolute CLOCK_MONOTONIC times (start + offset, + period, ...)
+ * and records each of them in the trace (rt/trace.h) and in the timing
+ * statistics (rt/stats.h).
+ *
+ * A job that ends after its next release is an overrun: the releases
+ * it missed entirely are skipped (and counted) and the next job starts
+ * at once, so a late task never builds up a backlog of jobs.
+ *
+ * An event-driven task gives a notification (rt/notify.h) instead: a
+ * job is released by every publication on it (e.g. each new block in
+ * a CAB), or by every n-th one, and its release time is the time of
+ * that publication, so the statistics measure the latency from the
+ * data to the end of the job. Publications missed while a job runs are
+ * skipped (and counted) like the releases of a periodic task. period
+ * is then the minimum inter-arrival time (for the statistics).
+ *
+ * rtTaskStop ends the tasks: each one finishes its current job, its
+ * thread returns instead of waiting for the next release, and is
+ * joined. Periodic tasks wait for their releases on a futex with an
+ * absolute time limit rather than in clock_nanosleep, so that the stop
+ * can cut the wait short.
+ * ************************************************************/
+
+#ifndef _RTTASK_H
+#define _RTTASK_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <time.h>
+#include "notify.h"
+#include "rtmem.h"
+
+typedef struct rtTask rtTask;
+
+struct rtTask {
+    /* Table entry */
+    const char *name;           /* Trace and statistics name */
+    int periodMs;               /* Period, or minimum inter-arrival (event-driven) */
+    int offsetMs;               /* First release, after rtTaskStart */
+    int deadlineMs;             /* Relative deadline, 0: period */
+    int prio;                   /* SCHED_FIFO priority */
+    int cpu;                    /* CPU the thread runs on, -1: any */
+    rtNotify *event;            /* Releasing notification, NULL: periodic */
+    int every;                  /* Event-driven: one job per every publications (0: 1) */
+    int (*init)(rtTask *t);     /* Before the first job (NULL: none), != 0: rtTaskStart fails */
+    int (*body)(rtTask *t);     /* One job, returns 0 (or RTTASK_IDLE) */
+    size_t ctxSize;             /* State (scratch buffers) for init/body, 0: none */
+    int stackKb;                /* Thread stack, 0: RTTASK_STACK_KB */
+
+    /* Set by rtTaskStart and the task thread */
+    pthread_t thread;
+    void *ctx;                  /* State, zeroed (from the arena) */
+    int started;                /* Thread created (rtTaskStart), not joined yet */
+    struct timespec release;    /* Release of the current job (body may refine it) */
+    uint32_t block;             /* Block processed by the current job (0: none), set by body */
+    int traceId;
+    int statsId;
+    uint64_t jobs;
+    unsigned eventSeq;          /* Publications handled (event-driven) */
+    uint64_t skipped;           /* Releases skipped after overruns */
+    rtNotify done;              /* Published at the end of each job (e.g. to pace a producer) */
+};
+
+/* Returned by body when the release found nothing to do: the job is
+ * traced but not recorded in the statistics */
+#define RTTASK_IDLE 1
+
+#define RTTASK_STACK_KB 256         /* Default thread stack */
+#define RTTASK_STACK_MARGIN_KB 16   /* Not touched: thread start frames, TLS */
+
+/* *******************************************************************
+ * Creates the thread of each task
+ * Args are:
+ * 		rtTask *tasks: task table (must outlive the threads)
+ * 		int n: number of tasks
+ * 		long startDelayNs: delay of the common start time (the offsets
+ *                    count from it) after every thread has run its init
+ *                    and subscribed to its event: no task is released
+ *                    before all of them are ready
+ * 		rtArena *arena: where the task states are taken from
+ * Returns 0, or -1 (message on stderr) if a state does not fit in the
+ * arena, a task's CPU is not one the process may run on, a thread
+ * cannot be created (SCHED_FIFO requires privileges) or the init of a
+ * task fails. No job has run then: the threads
+ * already created are stopped and joined
+ * *******************************************************************/
+int rtTaskStart(rtTask *tasks, int n, long startDelayNs, rtArena *arena);
+
+/* *******************************************************************
+ * Stops the tasks and waits for their threads to end (each one ends
+ * after its current job). Closes the notifications of the event-driven
+ * tasks and the done notifications, so call it once their publishers
+ * are stopped.
+ * Safe to call if rtTaskStart failed part way, or more than once
+ * *******************************************************************/
+void rtTaskStop(rtTask *tasks, int n);
+
+/* *******************************************************************
+ * Gives the calling thread a SCHED_FIFO priority and a CPU, e.g. a
+ * thread created by a library (the SDL audio thread, from its callback)
+ * Args are:
+ * 		int prio: SCHED_FIFO priority, 0: unchanged
+ * 		int cpu: CPU to run on, -1: unchanged
+ * Returns 0, or the error number of the first call that failed
+ * *******************************************************************/
+int rtPlaceThread(int prio, int cpu);
+
+/* *******************************************************************
+ * Prints the effective placement of a thread: scheduling policy,
+ * priority and the CPUs it may run on
+ * *******************************************************************/
+void rtPrintPlacement(FILE *f, const char *name, pthread_t thread);
+
+/* *******************************************************************
+ * Prints the placement of each task (after rtTaskStart)
+ * *******************************************************************/
+void rtTaskReport(FILE *f, const rtTask *tasks, int n);
+
+#endif
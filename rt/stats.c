@@ -0,0 +1,291 @@
+/* ************************************************************
+ * Per-task timing statistics
+ * ************************************************************/
+
+#include <string.h>
+#include <stdarg.h>
+#include <signal.h>
+#include <pthread.h>
+#include "stats.h"
+
+#define NS_IN_SEC 1000000000L
+#define HIST_HALF (1 << (HIST_SUB_BITS - 1))
+
+static taskStats tasks[STATS_MAX_TASKS];
+static atomic_int ntasks;
+static atomic_int ready[STATS_MAX_TASKS];
+static outputStats outputs[STATS_MAX_OUTPUTS];
+static atomic_int noutputs;
+
+/* ***********************************************
+ * HDR histogram
+ * ***********************************************/
+static int hdrIndex(uint64_t v) {
+    if (v >= (1ULL << HIST_MAX_LOG2)) v = (1ULL << HIST_MAX_LOG2) - 1;
+    if (v < (1ULL << HIST_SUB_BITS)) return (int)v;
+
+    int shift = (63 - __builtin_clzll(v)) - HIST_SUB_BITS + 1;
+    return (shift + 1) * HIST_HALF + (int)(v >> shift) - HIST_HALF;
+}
+
+static uint64_t hdrHighest(int idx) {
+    if (idx < (1 << HIST_SUB_BITS)) return idx;
+
+    int shift = idx / HIST_HALF - 1;
+    uint64_t sub = idx % HIST_HALF + HIST_HALF;
+    return ((sub + 1) << shift) - 1;
+}
+
+void hdrReset(hdrHist *h) {
+    memset(h->counts, 0, sizeof(h->counts));
+    h->total = 0;
+    h->sum = 0;
+    h->min = UINT64_MAX;
+    h->max = 0;
+}
+
+void hdrRecord(hdrHist *h, uint64_t v) {
+    h->counts[hdrIndex(v)]++;
+    h->total++;
+    h->sum += v;
+    if (v < h->min) h->min = v;
+    if (v > h->max) h->max = v;
+}
+
+uint64_t hdrPercentile(const hdrHist *h, double p) {
+    if (h->total == 0) return 0;
+
+    uint64_t rank = (uint64_t)(p / 100.0 * h->total + 0.5), seen = 0;
+    if (rank < 1) rank = 1;
+    for (int i = 0; i < HIST_BUCKETS; i++) {
+        seen += h->counts[i];
+        if (seen >= rank) {
+            uint64_t v = hdrHighest(i);
+            return (v < h->max) ? v : h->max;
+        }
+    }
+    return h->max;
+}
+
+/* ***********************************************
+ * Task table
+ * ***********************************************/
+static uint64_t tsToNs(const struct timespec *t) {
+    return (uint64_t)t->tv_sec * NS_IN_SEC + t->tv_nsec;
+}
+
+/* b - a, 0 if b is before a */
+static uint64_t elapsedNs(const struct timespec *a, const struct timespec *b) {
+    uint64_t na = tsToNs(a), nb = tsToNs(b);
+    return (nb > na) ? nb - na : 0;
+}
+
+int statsRegister(const char *name, int prio, const struct timespec *period,
+                  const struct timespec *deadline) {
+    int id = atomic_fetch_add(&ntasks, 1);
+
+    if (id >= STATS_MAX_TASKS) {
+        atomic_fetch_sub(&ntasks, 1);
+        return -1;
+    }
+
+    taskStats *t = &tasks[id];
+    strncpy(t->name, name, STATS_NAME_LEN - 1);
+    t->name[STATS_NAME_LEN - 1] = '\0';
+    t->prio = prio;
+    t->period_ns = tsToNs(period);
+    t->deadline_ns = (deadline != NULL) ? tsToNs(deadline) : t->period_ns;
+    atomic_init(&t->seq, 0);
+    t->jobs = 0;
+    t->misses = 0;
+    t->overruns = 0;
+    hdrReset(&t->exec);
+    hdrReset(&t->jitter);
+    hdrReset(&t->response);
+    atomic_store_explicit(&ready[id], 1, memory_order_release);
+    return id;
+}
+
+void statsJob(int id, const struct timespec *release, const struct timespec *start,
+              const struct timespec *end) {
+    if (id < 0 || id >= STATS_MAX_TASKS) return;
+
+    taskStats *t = &tasks[id];
+    uint64_t response = elapsedNs(release, end);
+    unsigned seq = atomic_load_explicit(&t->seq, memory_order_relaxed);
+
+    atomic_store_explicit(&t->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    t->jobs++;
+    if (response > t->deadline_ns) t->misses++;
+    if (response > t->period_ns) t->overruns++;
+    hdrRecord(&t->exec, elapsedNs(start, end));
+    hdrRecord(&t->jitter, elapsedNs(release, start));
+    hdrRecord(&t->response, response);
+
+    atomic_store_explicit(&t->seq, seq + 2, memory_order_release);
+}
+
+int statsSnapshot(int id, taskStats *out) {
+    if (id < 0 || id >= STATS_MAX_TASKS
+        || !atomic_load_explicit(&ready[id], memory_order_acquire)) {
+        return -1;
+    }
+
+    taskStats *t = &tasks[id];
+    unsigned s0, s1;
+    do {
+        s0 = atomic_load_explicit(&t->seq, memory_order_acquire);
+        memcpy(out, t, sizeof(*out));
+        atomic_thread_fence(memory_order_acquire);
+        s1 = atomic_load_explicit(&t->seq, memory_order_relaxed);
+    } while ((s0 & 1) || s0 != s1);
+    return 0;
+}
+
+/* ***********************************************
+ * Output table
+ * ***********************************************/
+int statsRegisterOutput(const char *name) {
+    int id = atomic_load(&noutputs);
+
+    if (id >= STATS_MAX_OUTPUTS) return -1;
+
+    outputStats *o = &outputs[id];
+    strncpy(o->name, name, STATS_NAME_LEN - 1);
+    o->name[STATS_NAME_LEN - 1] = '\0';
+    atomic_init(&o->seq, 0);
+    o->decisions = 0;
+    o->lastBlock = 0;
+    hdrReset(&o->latency);
+    atomic_store_explicit(&noutputs, id + 1, memory_order_release);
+    return id;
+}
+
+void statsOutput(int id, uint32_t block, const struct timespec *captured,
+                 const struct timespec *decided) {
+    if (id < 0 || id >= STATS_MAX_OUTPUTS) return;
+
+    outputStats *o = &outputs[id];
+    unsigned seq = atomic_load_explicit(&o->seq, memory_order_relaxed);
+
+    atomic_store_explicit(&o->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    o->decisions++;
+    o->lastBlock = block;
+    hdrRecord(&o->latency, elapsedNs(captured, decided));
+
+    atomic_store_explicit(&o->seq, seq + 2, memory_order_release);
+}
+
+int statsOutputSnapshot(int id, outputStats *out) {
+    if (id < 0 || id >= atomic_load_explicit(&noutputs, memory_order_acquire)) return -1;
+
+    outputStats *o = &outputs[id];
+    unsigned s0, s1;
+    do {
+        s0 = atomic_load_explicit(&o->seq, memory_order_acquire);
+        memcpy(out, o, sizeof(*out));
+        atomic_thread_fence(memory_order_acquire);
+        s1 = atomic_load_explicit(&o->seq, memory_order_relaxed);
+    } while ((s0 & 1) || s0 != s1);
+    return 0;
+}
+
+/* Appends to buf, snprintf style: at = bytes the table needs so far */
+static void statsAppend(char *buf, size_t size, size_t *at, const char *fmt, ...) {
+    va_list ap;
+
+    va_start(ap, fmt);
+    int n = vsnprintf(buf + (*at < size ? *at : size), *at < size ? size - *at : 0, fmt, ap);
+    va_end(ap);
+    if (n > 0) *at += n;
+}
+
+size_t statsFormat(char *buf, size_t size) {
+    size_t at = 0;
+    taskStats s;
+    outputStats o;
+    int n = atomic_load(&ntasks);
+
+    statsAppend(buf, size, &at, " [TASK TIMING] (us)            |        execution time         |"
+               "    jitter     |   response    |\n");
+    statsAppend(buf, size, &at, " %-16s %4s %7s | %7s %7s %7s %7s | %6s %6s | %6s %6s | %5s %5s\n",
+            "task", "prio", "jobs", "avg", "p50", "p99", "WCET",
+            "p99", "max", "p99", "max", "miss", "ovr");
+    for (int i = 0; i < n && i < STATS_MAX_TASKS; i++) {
+        if (statsSnapshot(i, &s) != 0 || s.jobs == 0) continue;
+        statsAppend(buf, size, &at, " %-16s %4d %7llu | %7.1f %7.1f %7.1f %7.1f | %6.0f %6.0f | %6.0f %6.0f | %5llu %5llu\n",
+                s.name, s.prio, (unsigned long long)s.jobs,
+                s.exec.sum / 1000.0 / s.exec.total,
+                hdrPercentile(&s.exec, 50.0) / 1000.0,
+                hdrPercentile(&s.exec, 99.0) / 1000.0,
+                s.exec.max / 1000.0,
+                hdrPercentile(&s.jitter, 99.0) / 1000.0, s.jitter.max / 1000.0,
+                hdrPercentile(&s.response, 99.0) / 1000.0, s.response.max / 1000.0,
+                (unsigned long long)s.misses, (unsigned long long)s.overruns);
+    }
+
+    n = atomic_load(&noutputs);
+    if (n == 0) return at;
+    statsAppend(buf, size, &at, " [CAPTURE TO DECISION] (us)    |           latency             |\n");
+    statsAppend(buf, size, &at, " %-16s %12s | %7s %7s %7s %7s | %10s\n",
+            "output", "decisions", "avg", "p50", "p99", "max", "last block");
+    for (int i = 0; i < n; i++) {
+        if (statsOutputSnapshot(i, &o) != 0 || o.decisions == 0) continue;
+        statsAppend(buf, size, &at, " %-16s %12llu | %7.0f %7.0f %7.0f %7.0f | %10u\n",
+                o.name, (unsigned long long)o.decisions,
+                o.latency.sum / 1000.0 / o.latency.total,
+                hdrPercentile(&o.latency, 50.0) / 1000.0,
+                hdrPercentile(&o.latency, 99.0) / 1000.0,
+                o.latency.max / 1000.0, o.lastBlock);
+    }
+    return at;
+}
+
+void statsPrint(FILE *f) {
+    char buf[STATS_TEXT_MAX];
+
+    size_t n = statsFormat(buf, sizeof(buf));
+    fwrite(buf, 1, n < sizeof(buf) ? n : sizeof(buf) - 1, f);
+}
+
+/* ***********************************************
+ * Dump on signal
+ * ***********************************************/
+static sigset_t dumpSet;
+static const char *dumpPath;
+
+static void *statsDumper(void *arg) {
+    int sig;
+
+    (void)arg;
+    while (1) {
+        if (sigwait(&dumpSet, &sig) != 0) continue;
+
+        FILE *f = fopen(dumpPath, "a");
+        if (f == NULL) continue;
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        fprintf(f, "--- statistics at %ld.%03ld s (signal %d) ---\n",
+                (long)now.tv_sec, now.tv_nsec / 1000000, sig);
+        statsPrint(f);
+        fprintf(f, "\n");
+        fclose(f);
+    }
+    return NULL;
+}
+
+int statsDumpOnSignal(int sig, const char *path) {
+    pthread_t thread;
+
+    sigemptyset(&dumpSet);
+    sigaddset(&dumpSet, sig);
+    dumpPath = path;
+    if (pthread_sigmask(SIG_BLOCK, &dumpSet, NULL) != 0) return -1;
+    if (pthread_create(&thread, NULL, statsDumper, NULL) != 0) return -1;
+    pthread_detach(thread);
+    return 0;
+}
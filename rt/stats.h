@@ -0,0 +1,157 @@
+/* ************************************************************
+ * Per-task timing statistics
+ *
+ * Each task records every job (release, start and end times) in its
+ * own entry of a static table: execution time (end - start), release
+ * jitter (start - release) and response time (end - release) go into
+ * HDR-style histograms, and deadline misses (response > deadline) and
+ * overruns (response > period, i.e. the job was still running at its
+ * next release) are counted.
+ *
+ * The histograms are log-linear: exact below 2^HIST_SUB_BITS ns, then
+ * 2^(HIST_SUB_BITS-1) buckets per power of 2 (relative error < 3.2%).
+ * Recording is a few integer operations on fixed arrays: no
+ * allocation, no lock. Each entry is written by its task only and
+ * read through a sequence counter (statsSnapshot), so readers get a
+ * consistent copy without blocking the task.
+ *
+ * Outputs (results such as the speed, or a fault decision) have their
+ * own table: each decision is recorded with the capture time of the
+ * block it was computed from, and the capture-to-decision latency goes
+ * into a histogram, whatever chain of tasks produced it.
+ * ************************************************************/
+
+#ifndef _STATS_H
+#define _STATS_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <time.h>
+
+#define STATS_MAX_TASKS 16
+#define STATS_MAX_OUTPUTS 8
+#define STATS_TEXT_MAX 8192         /* Bytes of the tables of statsFormat */
+#define STATS_NAME_LEN 20
+#define HIST_SUB_BITS 6
+#define HIST_MAX_LOG2 36            /* Values up to 2^36 ns (~68 s), larger ones are clamped */
+#define HIST_BUCKETS ((HIST_MAX_LOG2 - HIST_SUB_BITS + 2) << (HIST_SUB_BITS - 1))
+
+typedef struct {
+    uint32_t counts[HIST_BUCKETS];
+    uint64_t total;                 /* Values recorded */
+    uint64_t sum;
+    uint64_t min;
+    uint64_t max;
+} hdrHist;
+
+typedef struct {
+    char name[STATS_NAME_LEN];
+    int prio;
+    uint64_t period_ns;             /* Period, or minimum inter-arrival */
+    uint64_t deadline_ns;
+    atomic_uint seq;                /* Odd while the task updates the entry */
+    uint64_t jobs;
+    uint64_t misses;                /* response > deadline */
+    uint64_t overruns;              /* response > period */
+    hdrHist exec;                   /* end - start */
+    hdrHist jitter;                 /* start - release */
+    hdrHist response;               /* end - release */
+} taskStats;
+
+typedef struct {
+    char name[STATS_NAME_LEN];
+    atomic_uint seq;                /* Odd while the producer updates the entry */
+    uint64_t decisions;
+    uint32_t lastBlock;             /* Source block of the last decision */
+    hdrHist latency;                /* decision - capture of the source block */
+} outputStats;
+
+/* *******************************************************************
+ * HDR histogram: clear, record a value, value at a percentile
+ * hdrPercentile returns the highest value of the bucket holding the
+ * p-th percentile (0 <= p <= 100), 0 if the histogram is empty
+ * *******************************************************************/
+void hdrReset(hdrHist *h);
+void hdrRecord(hdrHist *h, uint64_t v);
+uint64_t hdrPercentile(const hdrHist *h, double p);
+
+/* *******************************************************************
+ * Registers a task
+ * Args are:
+ * 		const char *name: task name (truncated to 19 chars)
+ * 		int prio: priority (for the reports)
+ * 		const struct timespec *period: period (or minimum inter-arrival
+ *                    time of a sporadic task)
+ * 		const struct timespec *deadline: relative deadline, NULL if
+ *                    equal to the period
+ * Returns the task id, or -1 if STATS_MAX_TASKS are registered
+ * Call once per task, at its start (not in the real-time loop)
+ * *******************************************************************/
+int statsRegister(const char *name, int prio, const struct timespec *period,
+                  const struct timespec *deadline);
+
+/* *******************************************************************
+ * Records one job of a task (CLOCK_MONOTONIC times)
+ * Only the task itself may record in its entry (ignored if id < 0)
+ * *******************************************************************/
+void statsJob(int id, const struct timespec *release, const struct timespec *start,
+              const struct timespec *end);
+
+/* *******************************************************************
+ * Copies the entry of a task, consistently (retries while it changes)
+ * Returns 0, or -1 if id is not a registered task
+ * *******************************************************************/
+int statsSnapshot(int id, taskStats *out);
+
+/* *******************************************************************
+ * Registers an output
+ * Args are:
+ * 		const char *name: output name (truncated to 19 chars)
+ * Returns the output id, or -1 if STATS_MAX_OUTPUTS are registered
+ * Call before the producers start (not in the real-time loop)
+ * *******************************************************************/
+int statsRegisterOutput(const char *name);
+
+/* *******************************************************************
+ * Records one decision of an output (CLOCK_MONOTONIC times)
+ * Args are:
+ * 		int id: output (ignored if < 0)
+ * 		uint32_t block: sequence number of the source block
+ * 		const struct timespec *captured: capture of the source block
+ * 		const struct timespec *decided: time the result was published
+ * Only one thread may record in an output
+ * *******************************************************************/
+void statsOutput(int id, uint32_t block, const struct timespec *captured,
+                 const struct timespec *decided);
+
+/* *******************************************************************
+ * Copies the entry of an output, consistently
+ * Returns 0, or -1 if id is not a registered output
+ * *******************************************************************/
+int statsOutputSnapshot(int id, outputStats *out);
+
+/* *******************************************************************
+ * Formats a table of all the tasks, then one of the outputs (times in
+ * us) into buf, without allocating
+ * Args are:
+ * 		char *buf: output, always '\0'-terminated (if size > 0)
+ * 		size_t size: size of buf (STATS_TEXT_MAX holds the full tables)
+ * Returns the length of the full tables (as snprintf: >= size if cut)
+ * *******************************************************************/
+size_t statsFormat(char *buf, size_t size);
+
+/* *******************************************************************
+ * Prints the tables of statsFormat to f
+ * *******************************************************************/
+void statsPrint(FILE *f);
+
+/* *******************************************************************
+ * Starts a thread that appends the table to a file on each signal sig
+ * (e.g. SIGUSR1). sig is blocked in the calling thread, so call it
+ * from main before creating the other threads (they inherit the mask)
+ * Returns 0, or -1 if the thread cannot be created
+ * *******************************************************************/
+int statsDumpOnSignal(int sig, const char *path);
+
+#endif
@@ -0,0 +1,176 @@
+/* ************************************************************
+ * Binary execution trace (Gantt data)
+ *
+ * Ring i is written by task i only (head) and read by the drainer
+ * only (tail): head is stored with release after the record is
+ * written, and tail with release after the record is copied out, so
+ * neither side ever sees a half-written record.
+ * ************************************************************/
+
+#define _GNU_SOURCE             /* sched_getcpu */
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "trace.h"
+
+#define NS_IN_SEC 1000000000L
+
+_Static_assert(sizeof(traceRecord) == 32, "trace records are 32 bytes");
+_Static_assert(sizeof(traceTaskRecord) == 32, "trace records are 32 bytes");
+
+typedef struct {
+    traceRecord rec[TRACE_RING_SIZE];
+    atomic_uint head;           /* Records written (task) */
+    atomic_uint tail;           /* Records drained (drainer) */
+    atomic_uint dropped;
+    atomic_int ready;           /* name/prio set, ring usable */
+    int described;              /* TRACE_REC_TASK written (drainer only) */
+    int prio;
+    char name[TRACE_NAME_LEN];
+} traceRing;
+
+static traceRing rings[TRACE_MAX_TASKS];
+static atomic_int nrings;
+
+static FILE *traceFile;
+static pthread_t drainer;
+static atomic_int running;
+static int drainPeriodMs;
+
+int traceRegister(const char *name, int prio) {
+    int id = atomic_fetch_add(&nrings, 1);
+
+    if (id >= TRACE_MAX_TASKS) {
+        atomic_fetch_sub(&nrings, 1);
+        return -1;
+    }
+
+    traceRing *r = &rings[id];
+    strncpy(r->name, name, TRACE_NAME_LEN - 1);
+    r->name[TRACE_NAME_LEN - 1] = '\0';
+    r->prio = prio;
+    atomic_init(&r->head, 0);
+    atomic_init(&r->tail, 0);
+    atomic_init(&r->dropped, 0);
+    atomic_store_explicit(&r->ready, 1, memory_order_release);
+    return id;
+}
+
+void traceEvent(int task, const struct timespec *start, const struct timespec *end, uint32_t block) {
+    if (task < 0 || task >= TRACE_MAX_TASKS) return;
+
+    traceRing *r = &rings[task];
+    unsigned head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+
+    if (head - tail >= TRACE_RING_SIZE) {
+        atomic_fetch_add_explicit(&r->dropped, 1, memory_order_relaxed);
+        return;
+    }
+
+    traceRecord *rec = &r->rec[head & (TRACE_RING_SIZE - 1)];
+    rec->type = TRACE_REC_JOB;
+    rec->task = (uint16_t)task;
+    rec->cpu = (int16_t)sched_getcpu();
+    rec->start_ns = (uint64_t)start->tv_sec * NS_IN_SEC + start->tv_nsec;
+    rec->end_ns = (uint64_t)end->tv_sec * NS_IN_SEC + end->tv_nsec;
+    rec->block = block;
+    rec->prio = r->prio;
+
+    atomic_store_explicit(&r->head, head + 1, memory_order_release);
+}
+
+/* Writes the pending records of every ring (drainer thread only) */
+static void traceDrain(void) {
+    int n = atomic_load(&nrings);
+
+    for (int i = 0; i < n && i < TRACE_MAX_TASKS; i++) {
+        traceRing *r = &rings[i];
+        if (!atomic_load_explicit(&r->ready, memory_order_acquire)) continue;
+
+        if (!r->described) {
+            traceTaskRecord t;
+            memset(&t, 0, sizeof(t));
+            t.type = TRACE_REC_TASK;
+            t.task = (uint16_t)i;
+            t.prio = r->prio;
+            memcpy(t.name, r->name, TRACE_NAME_LEN);
+            fwrite(&t, sizeof(t), 1, traceFile);
+            r->described = 1;
+        }
+
+        unsigned tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+        unsigned head = atomic_load_explicit(&r->head, memory_order_acquire);
+        while (tail != head) {
+            /* Contiguous part, up to the end of the ring */
+            unsigned start = tail & (TRACE_RING_SIZE - 1);
+            unsigned count = head - tail;
+            if (count > TRACE_RING_SIZE - start) count = TRACE_RING_SIZE - start;
+            fwrite(&r->rec[start], sizeof(traceRecord), count, traceFile);
+            tail += count;
+        }
+        atomic_store_explicit(&r->tail, tail, memory_order_release);
+    }
+    fflush(traceFile);
+}
+
+static void *traceDrainer(void *arg) {
+    struct timespec period = { drainPeriodMs / 1000, (drainPeriodMs % 1000) * 1000000L };
+
+    (void)arg;
+    while (atomic_load(&running)) {
+        traceDrain();
+        while (nanosleep(&period, &period) != 0 && errno == EINTR);
+        period.tv_sec = drainPeriodMs / 1000;
+        period.tv_nsec = (drainPeriodMs % 1000) * 1000000L;
+    }
+    return NULL;
+}
+
+int traceStart(const char *path, int periodMs) {
+    struct {
+        char magic[8];
+        uint32_t version;
+        uint32_t recordSize;
+    } header = { "RTTRACE", TRACE_VERSION, sizeof(traceRecord) };
+
+    traceFile = fopen(path, "wb");
+    if (traceFile == NULL) return -1;
+    if (fwrite(&header, sizeof(header), 1, traceFile) != 1) {
+        fclose(traceFile);
+        traceFile = NULL;
+        return -1;
+    }
+
+    drainPeriodMs = (periodMs > 0) ? periodMs : 1;
+    atomic_store(&running, 1);
+    int err = pthread_create(&drainer, NULL, traceDrainer, NULL);
+    if (err != 0) {
+        atomic_store(&running, 0);
+        fclose(traceFile);
+        traceFile = NULL;
+        errno = err;
+        return -1;
+    }
+    return 0;
+}
+
+unsigned traceStop(void) {
+    unsigned dropped = 0;
+
+    if (traceFile == NULL) return 0;
+
+    atomic_store(&running, 0);
+    pthread_join(drainer, NULL);
+    traceDrain();
+    fclose(traceFile);
+    traceFile = NULL;
+
+    for (int i = 0; i < atomic_load(&nrings) && i < TRACE_MAX_TASKS; i++) {
+        dropped += atomic_load(&rings[i].dropped);
+    }
+    return dropped;
+}
@@ -0,0 +1,94 @@
+/* ************************************************************
+ * Binary execution trace (Gantt data)
+ *
+ * Each traced task (thread, audio callback) owns a single-producer,
+ * single-consumer ring of fixed-size records. Recording a job is a few
+ * stores and one atomic release: no lock, no system call, no I/O, so
+ * it can be done from real-time threads and from the audio callback.
+ * A low-priority drainer thread periodically writes the rings, in
+ * batches, to a binary file; trace2csv.py converts it to the CSV read
+ * by gantt_chart.py.
+ *
+ * File format (little-endian, as written by the host):
+ *    header: char magic[8] = "RTTRACE", uint32 version, uint32 record size
+ *    records of 32 bytes, type first:
+ *       TRACE_REC_TASK: a task (id, priority, name), written before its
+ *                       first job
+ *       TRACE_REC_JOB:  one activation (task id, CPU, start/end ns,
+ *                       block number)
+ * ************************************************************/
+
+#ifndef _TRACE_H
+#define _TRACE_H
+
+#include <stdint.h>
+#include <time.h>
+
+#define TRACE_MAX_TASKS 16
+#define TRACE_RING_SIZE 1024        /* Records per task (power of 2) */
+#define TRACE_NAME_LEN 20           /* Including the terminating '\0' */
+#define TRACE_VERSION 1
+
+enum {
+    TRACE_REC_TASK = 1,
+    TRACE_REC_JOB = 2
+};
+
+/* One job (activation) of a task */
+typedef struct {
+    uint32_t type;          /* TRACE_REC_JOB */
+    uint16_t task;          /* Task id (traceRegister) */
+    int16_t cpu;            /* CPU at the end of the job (-1: unknown) */
+    uint64_t start_ns;      /* CLOCK_MONOTONIC */
+    uint64_t end_ns;
+    uint32_t block;         /* Captured block processed (0: none) */
+    int32_t prio;
+} traceRecord;
+
+/* Task description, written to the file only */
+typedef struct {
+    uint32_t type;          /* TRACE_REC_TASK */
+    uint16_t task;
+    int16_t reserved;
+    int32_t prio;
+    char name[TRACE_NAME_LEN];
+} traceTaskRecord;
+
+/* *******************************************************************
+ * Registers a task and gives it a ring
+ * Args are:
+ * 		const char *name: task name in the CSV (truncated to 19 chars)
+ * 		int prio: priority in the CSV
+ * Returns the task id, or -1 if TRACE_MAX_TASKS are registered
+ * Call once per task, at its start (not in the real-time loop)
+ * *******************************************************************/
+int traceRegister(const char *name, int prio);
+
+/* *******************************************************************
+ * Records one job of a task (lock-free, wait-free)
+ * Args are:
+ * 		int task: id from traceRegister (ignored if < 0)
+ * 		start, end: CLOCK_MONOTONIC times of the job
+ * 		uint32_t block: number of the block it processed (0: none)
+ * Only the task itself may record in its ring. If the ring is full
+ * (drainer late) the record is dropped and counted.
+ * *******************************************************************/
+void traceEvent(int task, const struct timespec *start, const struct timespec *end, uint32_t block);
+
+/* *******************************************************************
+ * Opens the file and starts the drainer thread
+ * Args are:
+ * 		const char *path: trace file (truncated)
+ * 		int periodMs: drain period (the rings must hold the records of
+ *                    one period)
+ * Returns 0, or -1 (errno set) if the file or thread cannot be created
+ * *******************************************************************/
+int traceStart(const char *path, int periodMs);
+
+/* *******************************************************************
+ * Stops the drainer, writes the remaining records and closes the file
+ * Returns the number of records dropped because a ring was full
+ * *******************************************************************/
+unsigned traceStop(void);
+
+#endif
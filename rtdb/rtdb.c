@@ -0,0 +1,82 @@
+/* ************************************************************
+ * Real-time database (RTDB): seqlock records
+ * ************************************************************/
+
+#include <string.h>
+#include <sched.h>
+#include "rtdb.h"
+
+#define NS_IN_SEC 1000000000L
+
+void rtdbInit(rtdb *db) {
+    rtdbRecord *records[] = { &db->speed, &db->issue, &db->direction };
+
+    for (size_t i = 0; i < sizeof(records) / sizeof(records[0]); i++) {
+        atomic_init(&records[i]->seq, 0);
+        records[i]->updates = 0;
+        records[i]->updated_ns = 0;
+        memset(records[i]->value, 0, RTDB_VALUE_MAX);
+    }
+}
+
+void rtdbWrite(rtdbRecord *r, const void *value, size_t size, const struct timespec *now) {
+    unsigned seq = atomic_load_explicit(&r->seq, memory_order_relaxed);
+
+    if (size > RTDB_VALUE_MAX) size = RTDB_VALUE_MAX;
+    atomic_store_explicit(&r->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    memcpy(r->value, value, size);
+    r->updates++;
+    r->updated_ns = rtdbNs(now);
+
+    atomic_store_explicit(&r->seq, seq + 2, memory_order_release);
+}
+
+/* Consistent copy of a record in at most tries attempts (0: no limit) */
+static int readRecord(const rtdbRecord *r, rtdbRecord *copy, int tries) {
+    unsigned s0, s1;
+
+    for (int n = 1; ; n++) {
+        s0 = atomic_load_explicit((atomic_uint *)&r->seq, memory_order_acquire);
+        memcpy(copy, r, sizeof(*copy));
+        atomic_thread_fence(memory_order_acquire);
+        s1 = atomic_load_explicit((atomic_uint *)&r->seq, memory_order_relaxed);
+        if (!(s0 & 1) && s0 == s1) return 0;
+        if (tries > 0 && n >= tries) return -1;
+        if (tries > 0) sched_yield();  /* Another process: let its writer finish */
+    }
+}
+
+uint32_t rtdbRead(const rtdbRecord *r, void *value, size_t size, uint64_t *updated_ns) {
+    rtdbRecord copy;
+
+    if (size > RTDB_VALUE_MAX) size = RTDB_VALUE_MAX;
+    readRecord(r, &copy, 0);
+    memcpy(value, copy.value, size);
+    if (updated_ns != NULL) *updated_ns = copy.updated_ns;
+    return copy.updates;
+}
+
+int rtdbReadTries(const rtdbRecord *r, void *value, size_t size, uint64_t *updated_ns, int tries) {
+    rtdbRecord copy;
+
+    if (size > RTDB_VALUE_MAX) size = RTDB_VALUE_MAX;
+    if (readRecord(r, &copy, (tries > 0) ? tries : 1) != 0) {
+        memset(value, 0, size);
+        if (updated_ns != NULL) *updated_ns = 0;
+        return -1;
+    }
+    memcpy(value, copy.value, size);
+    if (updated_ns != NULL) *updated_ns = copy.updated_ns;
+    return (int)copy.updates;
+}
+
+uint64_t rtdbNs(const struct timespec *t) {
+    return (uint64_t)t->tv_sec * NS_IN_SEC + t->tv_nsec;
+}
+
+struct timespec rtdbTimespec(uint64_t ns) {
+    struct timespec t = { (time_t)(ns / NS_IN_SEC), (long)(ns % NS_IN_SEC) };
+    return t;
+}
@@ -0,0 +1,134 @@
+/* ************************************************************
+ * Real-time database (RTDB): latest result of each analysis task
+ *
+ * One record per result (speed, issue, direction), each one written by
+ * a single task and read by any number of others. A record is one
+ * cache line: a sequence counter, the number of updates, the time of
+ * the last one and the value. The writer makes the counter odd, copies
+ * the value and makes it even again; a reader copies the record and
+ * retries while the counter was odd or changed (seqlock). Writers never
+ * wait for readers and readers never block writers (no lock, no
+ * priority inversion), and a reader always gets all the fields of one
+ * update together.
+ *
+ * The values have a fixed layout (no pointers, times in ns of
+ * CLOCK_MONOTONIC), so the whole database can be placed in memory
+ * shared with other processes.
+ * ************************************************************/
+
+#ifndef _RTDB_H
+#define _RTDB_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include <time.h>
+
+#define RTDB_VALUE_MAX 48           /* Bytes of a value: the record is 64 */
+
+typedef struct {
+    _Alignas(64) atomic_uint seq;   /* Odd while the writer updates the record */
+    uint32_t updates;               /* Updates so far (0: no value yet) */
+    uint64_t updated_ns;            /* CLOCK_MONOTONIC of the last update */
+    unsigned char value[RTDB_VALUE_MAX];
+} rtdbRecord;
+
+/* Speed task: strongest peak of the speed band */
+typedef struct {
+    float hz;
+    float amplitude;
+    uint32_t block;                 /* Source block (seq) */
+    uint32_t reserved;
+    uint64_t captured_ns;           /* Capture of the last sample of the estimate's frame */
+    uint64_t sample;                /* That sample (offset in the captured stream) */
+} rtdbSpeed;
+
+/* Issue task: high band against the speed band */
+typedef struct {
+    float hz;                       /* Strongest component above the threshold */
+    float ratio;                    /* Its amplitude / the speed band's */
+    uint32_t fault;                 /* 1: fault detected */
+    uint32_t block;                 /* Source block (seq) */
+    uint64_t captured_ns;
+} rtdbIssue;
+
+/* Direction task: speed trend */
+typedef struct {
+    int32_t direction;              /* 1 accelerating, -1 decelerating, 2 stable, 0 stopped */
+    float speedHz;                  /* Speed it was decided on */
+    float amplitude;
+    uint32_t block;                 /* Block of that speed (seq) */
+    uint64_t captured_ns;
+} rtdbDirection;
+
+typedef struct {
+    rtdbRecord speed;
+    rtdbRecord issue;
+    rtdbRecord direction;
+} rtdb;
+
+_Static_assert(sizeof(rtdbRecord) == 64, "an RTDB record is one cache line");
+_Static_assert(sizeof(rtdbSpeed) <= RTDB_VALUE_MAX, "rtdbSpeed fits in a record");
+_Static_assert(sizeof(rtdbIssue) <= RTDB_VALUE_MAX, "rtdbIssue fits in a record");
+_Static_assert(sizeof(rtdbDirection) <= RTDB_VALUE_MAX, "rtdbDirection fits in a record");
+
+/* *******************************************************************
+ * Empties every record (no value yet)
+ * *******************************************************************/
+void rtdbInit(rtdb *db);
+
+/* *******************************************************************
+ * Writer (one per record): stores a value of size bytes
+ * Args are:
+ * 		rtdbRecord *r: the record
+ * 		const void *value: the value, size <= RTDB_VALUE_MAX bytes
+ * 		const struct timespec *now: time of the update (CLOCK_MONOTONIC)
+ * *******************************************************************/
+void rtdbWrite(rtdbRecord *r, const void *value, size_t size, const struct timespec *now);
+
+/* *******************************************************************
+ * Reader: consistent copy of the latest value (zeroed if none yet)
+ * Args are:
+ * 		const rtdbRecord *r: the record
+ * 		void *value: output, size bytes
+ * 		uint64_t *updated_ns: output, time of that update (NULL: not needed)
+ * Returns the number of updates so far (0: no value yet)
+ * *******************************************************************/
+uint32_t rtdbRead(const rtdbRecord *r, void *value, size_t size, uint64_t *updated_ns);
+
+/* *******************************************************************
+ * Reader in another process: as rtdbRead, but gives up after tries
+ * attempts (yielding the CPU between them), since a writer that died
+ * in the middle of an update leaves the counter odd for good
+ * Returns the number of updates so far, or -1 (value zeroed) if no
+ * consistent copy was made
+ * *******************************************************************/
+int rtdbReadTries(const rtdbRecord *r, void *value, size_t size, uint64_t *updated_ns, int tries);
+
+/* Typed access */
+static inline void rtdbSetSpeed(rtdb *db, const rtdbSpeed *v, const struct timespec *now) {
+    rtdbWrite(&db->speed, v, sizeof(*v), now);
+}
+static inline void rtdbSetIssue(rtdb *db, const rtdbIssue *v, const struct timespec *now) {
+    rtdbWrite(&db->issue, v, sizeof(*v), now);
+}
+static inline void rtdbSetDirection(rtdb *db, const rtdbDirection *v, const struct timespec *now) {
+    rtdbWrite(&db->direction, v, sizeof(*v), now);
+}
+static inline uint32_t rtdbGetSpeed(const rtdb *db, rtdbSpeed *v, uint64_t *updated_ns) {
+    return rtdbRead(&db->speed, v, sizeof(*v), updated_ns);
+}
+static inline uint32_t rtdbGetIssue(const rtdb *db, rtdbIssue *v, uint64_t *updated_ns) {
+    return rtdbRead(&db->issue, v, sizeof(*v), updated_ns);
+}
+static inline uint32_t rtdbGetDirection(const rtdb *db, rtdbDirection *v, uint64_t *updated_ns) {
+    return rtdbRead(&db->direction, v, sizeof(*v), updated_ns);
+}
+
+/* *******************************************************************
+ * Conversions between struct timespec and the ns of the records
+ * *******************************************************************/
+uint64_t rtdbNs(const struct timespec *t);
+struct timespec rtdbTimespec(uint64_t ns);
+
+#endif
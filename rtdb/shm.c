@@ -0,0 +1,245 @@
+/* ************************************************************
+ * Shared-memory export of the RTDB and of the latest spectrum
+ * ************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sched.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include "shm.h"
+
+/* 1 while the writer of a segment runs: state not ended and process alive */
+static int headerAlive(const rtdbShmHeader *h) {
+    if (atomic_load((atomic_uint *)&h->state) != RTDB_SHM_RUNNING) return 0;
+    return kill((pid_t)h->pid, 0) == 0 || errno == EPERM;  /* Killed: state not updated */
+}
+
+#define CREATE_TRIES 100      /* Looks at an empty segment, 1 ms apart, before replacing it */
+
+/* State of the segment open on fd: 1 if it can be replaced (RTDB
+ * segment of a writer that ended or died), 0 if its writer runs (*pid
+ * set), 2 if it is empty (not sized yet), -1 if it is not an RTDB
+ * segment */
+static int segmentState(int fd, uint32_t *pid) {
+    struct stat st;
+    int state = -1;
+
+    if (fstat(fd, &st) != 0) return -1;
+    if (st.st_size == 0) return 2;
+    if (st.st_size >= (off_t)sizeof(rtdbShmHeader)) {
+        const rtdbShmHeader *h = mmap(NULL, sizeof(*h), PROT_READ, MAP_SHARED, fd, 0);
+        if (h != MAP_FAILED) {
+            if (memcmp(h->magic, RTDB_SHM_MAGIC, sizeof(h->magic)) == 0) {
+                *pid = h->pid;
+                state = !headerAlive(h);
+            }
+            munmap((void *)h, sizeof(*h));
+        }
+    }
+    return state;
+}
+
+/* 1 if name is still the segment open on fd (not replaced meanwhile) */
+static int sameSegment(int fd, const char *name) {
+    struct stat a, b;
+    int same = 0;
+
+    int fd2 = shm_open(name, O_RDONLY, 0);
+    if (fd2 < 0) return 0;
+    if (fstat(fd, &a) == 0 && fstat(fd2, &b) == 0) {
+        same = (a.st_dev == b.st_dev && a.st_ino == b.st_ino);
+    }
+    close(fd2);
+    return same;
+}
+
+/* Existing segment name: removes it if it can be replaced, under its
+ * lock. rtdbShmCreate holds that lock until the header is written, so
+ * a segment is seen either complete or empty; an empty one is only
+ * replaced if it stays empty (its writer died before sizing it, rather
+ * than not having taken the lock yet).
+ * Returns 1 if name can be created again, 0 if its writer runs (*pid
+ * set), -1 if it is not an RTDB segment or cannot be removed */
+static int segmentReplace(const char *name, uint32_t *pid) {
+    for (int tries = 1; ; tries++) {
+        int fd = shm_open(name, O_RDONLY, 0);
+        if (fd < 0) return (errno == ENOENT) ? 1 : -1;  /* Removed meanwhile */
+        flock(fd, LOCK_EX);
+
+        int state = segmentState(fd, pid);
+        if (state == 1 || (state == 2 && tries >= CREATE_TRIES)) {
+            if (sameSegment(fd, name) && shm_unlink(name) != 0 && errno != ENOENT) state = -1;
+            else state = 1;
+        }
+        flock(fd, LOCK_UN);
+        close(fd);
+        if (state != 2) return state;
+
+        struct timespec wait = { 0, 1000000 };
+        nanosleep(&wait, NULL);
+    }
+}
+
+rtdbShm *rtdbShmCreate(const char *name, int fs, int N) {
+    struct timespec now;
+    uint32_t pid = 0;
+    int fd;
+
+    /* Locked before it is sized: see segmentReplace. Replaced segments
+     * may be recreated by another writer first, hence the loop */
+    for (int attempt = 0; ; attempt++) {
+        fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0644);
+        if (fd >= 0) {
+            flock(fd, LOCK_EX);
+            break;
+        }
+        if (errno != EEXIST || attempt == 3) break;
+
+        int stale = segmentReplace(name, &pid);
+        if (stale == 0) {
+            fprintf(stderr, "RTDB export %s: in use by rtsounds pid %u (choose another with -shm NAME, or -noshm)\n",
+                    name, pid);
+            errno = EBUSY;
+            return NULL;
+        }
+        if (stale < 0) {
+            fprintf(stderr, "RTDB export %s: exists and is not an RTDB segment (choose another with -shm NAME)\n",
+                    name);
+            errno = EBUSY;
+            return NULL;
+        }
+    }
+    if (fd < 0) {
+        fprintf(stderr, "RTDB export %s: cannot create [%s]\n", name, strerror(errno));
+        return NULL;
+    }
+    if (ftruncate(fd, sizeof(rtdbShm)) != 0) {
+        fprintf(stderr, "RTDB export %s: cannot size [%s]\n", name, strerror(errno));
+        close(fd);
+        shm_unlink(name);
+        return NULL;
+    }
+    rtdbShm *shm = mmap(NULL, sizeof(rtdbShm), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (shm == MAP_FAILED) {
+        fprintf(stderr, "RTDB export %s: cannot map [%s]\n", name, strerror(errno));
+        close(fd);
+        shm_unlink(name);
+        return NULL;
+    }
+
+    /* Zeroed by ftruncate; the magic goes last, readers check it */
+    rtdbInit(&shm->db);
+    atomic_init(&shm->spectrum.seq, 0);
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    shm->header.version = RTDB_SHM_VERSION;
+    shm->header.size = sizeof(rtdbShm);
+    shm->header.fs = fs;
+    shm->header.N = N;
+    shm->header.pid = (uint32_t)getpid();
+    shm->header.started_ns = rtdbNs(&now);
+    atomic_store(&shm->header.state, RTDB_SHM_RUNNING);
+    atomic_thread_fence(memory_order_release);
+    memcpy(shm->header.magic, RTDB_SHM_MAGIC, sizeof(shm->header.magic));
+    flock(fd, LOCK_UN);  /* The header is complete (the mapping would keep the lock) */
+    close(fd);
+    return shm;
+}
+
+void rtdbShmDestroy(rtdbShm *shm, const char *name) {
+    if (shm == NULL) return;
+    atomic_store(&shm->header.state, RTDB_SHM_ENDED);
+    munmap(shm, sizeof(rtdbShm));
+    shm_unlink(name);
+}
+
+void rtdbShmSetSpectrum(rtdbShm *shm, const float *Ak, int bins, float binHz, uint32_t block,
+                        const struct timespec *captured, const struct timespec *now) {
+    rtdbSpectrumRecord *r = &shm->spectrum;
+    unsigned seq = atomic_load_explicit(&r->seq, memory_order_relaxed);
+
+    if (bins > RTDB_SHM_MAX_BINS) bins = RTDB_SHM_MAX_BINS;
+    atomic_store_explicit(&r->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    memcpy(r->Ak, Ak, bins * sizeof(float));
+    r->bins = bins;
+    r->block = block;
+    r->updates++;
+    r->updated_ns = rtdbNs(now);
+    r->captured_ns = rtdbNs(captured);
+    r->binHz = binHz;
+
+    atomic_store_explicit(&r->seq, seq + 2, memory_order_release);
+}
+
+const rtdbShm *rtdbShmOpen(const char *name) {
+    struct stat st;
+
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) {
+        fprintf(stderr, "%s: no RTDB segment [%s] (is rtsounds running?)\n", name, strerror(errno));
+        return NULL;
+    }
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(rtdbShm)) {
+        fprintf(stderr, "%s: not an RTDB segment (%lld bytes)\n", name, (long long)st.st_size);
+        close(fd);
+        return NULL;
+    }
+    const rtdbShm *shm = mmap(NULL, sizeof(rtdbShm), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (shm == MAP_FAILED) {
+        fprintf(stderr, "%s: cannot map [%s]\n", name, strerror(errno));
+        return NULL;
+    }
+
+    if (memcmp(shm->header.magic, RTDB_SHM_MAGIC, sizeof(shm->header.magic)) != 0
+        || shm->header.version != RTDB_SHM_VERSION || shm->header.size != sizeof(rtdbShm)) {
+        fprintf(stderr, "%s: not a version %d RTDB segment\n", name, RTDB_SHM_VERSION);
+        rtdbShmClose(shm);
+        return NULL;
+    }
+    atomic_thread_fence(memory_order_acquire);
+    return shm;
+}
+
+void rtdbShmClose(const rtdbShm *shm) {
+    if (shm != NULL) munmap((void *)shm, sizeof(rtdbShm));
+}
+
+int rtdbShmAlive(const rtdbShm *shm) {
+    return headerAlive(&shm->header);
+}
+
+uint32_t rtdbShmGetSpectrum(const rtdbShm *shm, float *Ak, int maxBins, rtdbSpectrumInfo *info) {
+    const rtdbSpectrumRecord *r = &shm->spectrum;
+    unsigned s0, s1;
+    int tries = 0;
+
+    do {
+        if (tries > 0) sched_yield();  /* Let the writer finish */
+        if (tries++ == RTDB_SHM_READ_TRIES) {
+            memset(info, 0, sizeof(*info));  /* Writer stopped in the middle of an update */
+            return 0;
+        }
+        s0 = atomic_load_explicit((atomic_uint *)&r->seq, memory_order_acquire);
+        info->bins = r->bins;
+        info->block = r->block;
+        info->updates = r->updates;
+        info->updated_ns = r->updated_ns;
+        info->captured_ns = r->captured_ns;
+        info->binHz = r->binHz;
+        if (info->bins > (uint32_t)maxBins) info->bins = maxBins;
+        if (info->bins > RTDB_SHM_MAX_BINS) info->bins = RTDB_SHM_MAX_BINS;
+        memcpy(Ak, r->Ak, info->bins * sizeof(float));
+        atomic_thread_fence(memory_order_acquire);
+        s1 = atomic_load_explicit((atomic_uint *)&r->seq, memory_order_relaxed);
+    } while ((s0 & 1) || s0 != s1);
+    return info->updates;
+}
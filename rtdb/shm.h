@@ -0,0 +1,182 @@
+/* ************************************************************
+ * Shared-memory export of the RTDB and of the latest spectrum
+ *
+ * rtsounds places its RTDB (rtdb.h) in a POSIX shared-memory segment,
+ * so any number of other processes (dashboards, loggers, rtdbcat) can
+ * map it read-only and read the live values in place, at any rate: the
+ * tasks write their records as before, with no copy and no system
+ * call, and never wait for a reader. The Preprocessing task also
+ * publishes the amplitude spectrum of each block in the same way.
+ *
+ * Layout (version 1, native byte order, little endian on x86/ARM;
+ * offsets in bytes, every record read with its sequence counter as in
+ * rtdb.h: retry while it is odd or changed during the copy):
+ *      0   rtdbShmHeader (64)
+ *            0  char magic[8] = "RTSOUNDS"
+ *            8  uint32 version = RTDB_SHM_VERSION
+ *           12  uint32 size: bytes of the segment
+ *           16  uint32 fs: sampling frequency (Hz)
+ *           20  uint32 N: analysis frame (samples)
+ *           24  uint32 pid: writer process
+ *           28  uint32 state: 1 running, 2 ended (the writer exited)
+ *           32  uint64 started_ns: writer start (CLOCK_MONOTONIC)
+ *     64   rtdb: speed, issue, direction records (64 each)
+ *            record: 0 uint32 seq, 4 uint32 updates, 8 uint64
+ *            updated_ns, 16 value (rtdbSpeed, rtdbIssue, rtdbDirection)
+ *    256   rtdbSpectrumRecord
+ *            0  uint32 seq
+ *            4  uint32 bins: valid bins (N/2 + 1)
+ *            8  uint32 block: source block (seq)
+ *           12  uint32 updates
+ *           16  uint64 updated_ns
+ *           24  uint64 captured_ns: capture of the source block
+ *           32  float binHz: frequency step (fs / N)
+ *           40  float Ak[RTDB_SHM_MAX_BINS]: amplitude of bins 0 (DC) ..
+ *               bins - 1 (fs/2), scaled as fftGetAmplitude
+ * Times are CLOCK_MONOTONIC in ns (comparable between processes of the
+ * same host).
+ * ************************************************************/
+
+#ifndef _RTDB_SHM_H
+#define _RTDB_SHM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include <time.h>
+#include "rtdb.h"
+
+#define RTDB_SHM_NAME "/rtsounds"       /* Default segment (/dev/shm/rtsounds) */
+#define RTDB_SHM_MAGIC "RTSOUNDS"
+#define RTDB_SHM_VERSION 1
+#define RTDB_SHM_MAX_BINS 2049          /* Frames up to 4096 samples */
+
+#define RTDB_SHM_READ_TRIES 1000      /* Reader attempts at a consistent copy */
+
+#define RTDB_SHM_RUNNING 1
+#define RTDB_SHM_ENDED 2
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t size;
+    uint32_t fs;
+    uint32_t N;
+    uint32_t pid;
+    atomic_uint state;
+    uint64_t started_ns;
+    uint8_t reserved[24];
+} rtdbShmHeader;
+
+typedef struct {
+    _Alignas(64) atomic_uint seq;   /* Odd while the writer updates the record */
+    uint32_t bins;
+    uint32_t block;
+    uint32_t updates;
+    uint64_t updated_ns;
+    uint64_t captured_ns;
+    float binHz;
+    uint32_t reserved;
+    float Ak[RTDB_SHM_MAX_BINS];
+} rtdbSpectrumRecord;
+
+typedef struct {
+    rtdbShmHeader header;
+    rtdb db;
+    rtdbSpectrumRecord spectrum;
+} rtdbShm;
+
+_Static_assert(sizeof(rtdbShmHeader) == 64, "RTDB segment header is 64 bytes");
+_Static_assert(offsetof(rtdbShm, db) == 64, "RTDB records at offset 64");
+_Static_assert(offsetof(rtdbShm, spectrum) == 256, "spectrum at offset 256");
+_Static_assert(offsetof(rtdbSpectrumRecord, Ak) == 40, "spectrum bins at offset 40 of the record");
+
+/* Spectrum as read (bins are copied to the caller's array) */
+typedef struct {
+    uint32_t bins;
+    uint32_t block;
+    uint32_t updates;               /* 0: no spectrum yet */
+    uint64_t updated_ns;
+    uint64_t captured_ns;
+    float binHz;
+} rtdbSpectrumInfo;
+
+/* *******************************************************************
+ * Writer: creates the segment name, with an empty RTDB and no
+ * spectrum. An existing one is replaced only if its writer has ended
+ * or died: the segment is locked (flock) from its creation until its
+ * header is written, so one that is being created is never taken for
+ * the empty segment of a dead writer
+ * Args are:
+ * 		const char *name: POSIX shm name ("/rtsounds")
+ * 		int fs, int N: sampling frequency and frame, for the readers
+ * Returns the mapping, or NULL (message on stderr; errno EBUSY if name
+ * is used by a running rtsounds or by another program)
+ * *******************************************************************/
+rtdbShm *rtdbShmCreate(const char *name, int fs, int N);
+
+/* *******************************************************************
+ * Writer: marks the segment ended, unmaps and removes it (the readers
+ * that have it mapped keep their mapping)
+ * *******************************************************************/
+void rtdbShmDestroy(rtdbShm *shm, const char *name);
+
+/* *******************************************************************
+ * Writer (one task): publishes an amplitude spectrum
+ * Args are:
+ * 		rtdbShm *shm: the segment
+ * 		const float *Ak: bins 0 .. bins - 1 (at most RTDB_SHM_MAX_BINS)
+ * 		float binHz: frequency step
+ * 		uint32_t block: source block (seq)
+ * 		const struct timespec *captured, *now: capture of the block, update
+ * *******************************************************************/
+void rtdbShmSetSpectrum(rtdbShm *shm, const float *Ak, int bins, float binHz, uint32_t block,
+                        const struct timespec *captured, const struct timespec *now);
+
+/* *******************************************************************
+ * Reader: maps an existing segment read-only and checks its layout
+ * Returns the mapping, or NULL (message on stderr) if there is none,
+ * or it is not a version RTDB_SHM_VERSION segment
+ * *******************************************************************/
+const rtdbShm *rtdbShmOpen(const char *name);
+
+/* *******************************************************************
+ * Reader: unmaps the segment
+ * *******************************************************************/
+void rtdbShmClose(const rtdbShm *shm);
+
+/* *******************************************************************
+ * Reader: 1 while the writer runs, 0 once it has ended (or died)
+ * *******************************************************************/
+int rtdbShmAlive(const rtdbShm *shm);
+
+/* *******************************************************************
+ * Reader: consistent copy of the latest spectrum
+ * Args are:
+ * 		const rtdbShm *shm: the segment
+ * 		float *Ak: output, up to maxBins bins
+ * 		int maxBins: size of Ak
+ * 		rtdbSpectrumInfo *info: output (info->bins: bins copied)
+ * Returns the number of updates so far (0: no spectrum yet, or no
+ * consistent copy in RTDB_SHM_READ_TRIES attempts: info zeroed)
+ * *******************************************************************/
+uint32_t rtdbShmGetSpectrum(const rtdbShm *shm, float *Ak, int maxBins, rtdbSpectrumInfo *info);
+
+/* *******************************************************************
+ * Reader: the records of the segment, as rtdbGetSpeed... but with at
+ * most RTDB_SHM_READ_TRIES attempts (a writer killed in the middle of
+ * an update must not hang the reader)
+ * Return the number of updates, or -1 (value zeroed) if none was
+ * consistent
+ * *******************************************************************/
+static inline int rtdbShmGetSpeed(const rtdbShm *shm, rtdbSpeed *v, uint64_t *updated_ns) {
+    return rtdbReadTries(&shm->db.speed, v, sizeof(*v), updated_ns, RTDB_SHM_READ_TRIES);
+}
+static inline int rtdbShmGetIssue(const rtdbShm *shm, rtdbIssue *v, uint64_t *updated_ns) {
+    return rtdbReadTries(&shm->db.issue, v, sizeof(*v), updated_ns, RTDB_SHM_READ_TRIES);
+}
+static inline int rtdbShmGetDirection(const rtdbShm *shm, rtdbDirection *v, uint64_t *updated_ns) {
+    return rtdbReadTries(&shm->db.direction, v, sizeof(*v), updated_ns, RTDB_SHM_READ_TRIES);
+}
+
+#endif
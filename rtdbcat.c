@@ -0,0 +1,134 @@
+/* ************************************************************
+ * rtdbcat: prints the live results of a running rtsounds
+ *
+ * Maps the RTDB segment exported by rtsounds (rtdb/shm.h) read-only
+ * and prints its records, once or every -every ms until rtsounds
+ * ends; with -peaks K also the K strongest bins of the latest
+ * spectrum. It reads shared memory only: rtsounds is not slowed down
+ * by any number of readers.
+ *
+ *     ./rtdbcat [-name /rtsounds] [-every MS] [-peaks K] [-csv]
+ * ************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "rtdb/rtdb.h"
+#include "rtdb/shm.h"
+
+#define MAX_PEAKS 16
+
+static const char *directionName(int d) {
+    return (d == 1) ? "ACCEL" : (d == -1) ? "DECEL" : (d == 2) ? "STABLE" : "STOP";
+}
+
+// Milliseconds from a record time to now (-1: never updated)
+static double ageMs(uint64_t ns, uint64_t now) {
+    return (ns > 0) ? (now - ns) / 1e6 : -1.0;
+}
+
+// Strongest bins, largest first (bin 0, DC, excluded)
+static int topBins(const float *Ak, int bins, int *k, int K) {
+    int n = 0;
+
+    for (int i = 1; i < bins; i++) {
+        if (n == K && Ak[i] <= Ak[k[K - 1]]) continue;
+        int j = (n < K) ? n++ : K - 1;  // Full: the weakest one is replaced
+        while (j > 0 && Ak[k[j - 1]] < Ak[i]) {
+            k[j] = k[j - 1];
+            j--;
+        }
+        k[j] = i;
+    }
+    return n;
+}
+
+static void printOnce(const rtdbShm *shm, int peaks, int csv) {
+    static float Ak[RTDB_SHM_MAX_BINS];
+    rtdbSpeed speed;
+    rtdbIssue issue;
+    rtdbDirection dir;
+    rtdbSpectrumInfo info;
+    uint64_t t[3];
+    struct timespec ts;
+
+    // Bounded reads: -1 if rtsounds was killed in the middle of an update
+    int torn = (rtdbShmGetSpeed(shm, &speed, &t[0]) < 0) + (rtdbShmGetIssue(shm, &issue, &t[1]) < 0)
+             + (rtdbShmGetDirection(shm, &dir, &t[2]) < 0);
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    uint64_t now = rtdbNs(&ts);
+
+    if (csv) {
+        printf("%.3f,%.2f,%.1f,%u,%d,%.1f,%.4f,%u,%s,%u\n",
+               (now - shm->header.started_ns) / 1e9, speed.hz, speed.amplitude, speed.block,
+               issue.fault, issue.hz, issue.ratio, issue.block, directionName(dir.direction), dir.block);
+    } else {
+        printf("speed %8.2f Hz  amp %9.1f  block %6u  (%5.0f ms ago)\n",
+               speed.hz, speed.amplitude, speed.block, ageMs(t[0], now));
+        printf("issue %-6s  %8.1f Hz  ratio %6.3f  block %6u  (%5.0f ms ago)\n",
+               issue.fault ? "FAULT" : "OK", issue.hz, issue.ratio, issue.block, ageMs(t[1], now));
+        printf("direction %-6s  speed %8.2f Hz  block %6u  (%5.0f ms ago)\n",
+               directionName(dir.direction), dir.speedHz, dir.block, ageMs(t[2], now));
+    }
+
+    if (peaks > 0 && rtdbShmGetSpectrum(shm, Ak, RTDB_SHM_MAX_BINS, &info) > 0) {
+        int k[MAX_PEAKS];
+        int n = topBins(Ak, (int)info.bins, k, peaks);
+
+        printf("spectrum block %u, %u bins of %.2f Hz:", info.block, info.bins, info.binHz);
+        for (int i = 0; i < n; i++) printf("  %.1f Hz %.1f", k[i] * info.binHz, Ak[k[i]]);
+        printf("\n");
+    }
+    if (torn > 0) fprintf(stderr, "%d records in the middle of an update (writer stopped?)\n", torn);
+    if (!csv) printf("\n");
+    fflush(stdout);
+}
+
+static void usage(void) {
+    printf("Usage: ./rtdbcat [-name NAME] [-every MS] [-peaks K] [-csv]\n");
+    printf("   Prints the results of a running rtsounds (shared memory NAME, default %s)\n", RTDB_SHM_NAME);
+    printf("   -every MS: again every MS ms, until rtsounds ends\n");
+    printf("   -peaks K: also the K (<= %d) strongest bins of the latest spectrum\n", MAX_PEAKS);
+    printf("   -csv: one line per read (time,speedHz,speedAmp,speedBlock,fault,issueHz,\n");
+    printf("         issueRatio,issueBlock,direction,directionBlock)\n");
+}
+
+int main(int argc, char *argv[]) {
+    const char *name = RTDB_SHM_NAME;
+    int everyMs = 0, peaks = 0, csv = 0;
+
+    for (int a = 1; a < argc; a++) {
+        if (strcmp(argv[a], "-name") == 0 && a + 1 < argc) {
+            name = argv[++a];
+        } else if (strcmp(argv[a], "-every") == 0 && a + 1 < argc) {
+            everyMs = atoi(argv[++a]);
+        } else if (strcmp(argv[a], "-peaks") == 0 && a + 1 < argc) {
+            peaks = atoi(argv[++a]);
+            if (peaks > MAX_PEAKS) peaks = MAX_PEAKS;
+        } else if (strcmp(argv[a], "-csv") == 0) {
+            csv = 1;
+        } else {
+            usage();
+            return 1;
+        }
+    }
+
+    const rtdbShm *shm = rtdbShmOpen(name);
+    if (shm == NULL) return 1;
+
+    if (!csv) {
+        printf("rtsounds pid %u, %u Hz, frame %u samples%s\n\n", shm->header.pid, shm->header.fs,
+               shm->header.N, rtdbShmAlive(shm) ? "" : " (ended)");
+    }
+    printOnce(shm, peaks, csv);
+    if (everyMs > 0) {
+        struct timespec period = { everyMs / 1000, (everyMs % 1000) * 1000000L };
+        while (rtdbShmAlive(shm)) {
+            nanosleep(&period, NULL);
+            printOnce(shm, peaks, csv);
+        }
+    }
+    rtdbShmClose(shm);
+    return 0;
+}
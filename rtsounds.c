@@ -1,7 +1,7 @@
 #define _GNU_SOURCE /* Must precede #include <sched.h> for sched_setaffinity */ 
 #define __USE_MISC
 #define ABUFSIZE_SAMPLES 4096
-#define NTASKS 7
+#define NTASKS 8
 #include "rtsounds.h"
 #include <math.h>
 #include <complex.h>
@@ -9,8 +9,10 @@
 #include <string.h>
 #include <stdio.h>
 #include <SDL.h>
-#include <semaphore.h>
 #include <time.h>    // added for timestamped filenames
+#include <sys/resource.h>  // getrusage (CPU time report)
+#include <sys/signalfd.h>  // SIGINT at the device prompt
+#include <poll.h>
 
 struct timespec TsAdd(struct timespec ts1, struct timespec ts2) {
     struct timespec tr;
@@ -23,549 +25,779 @@ struct timespec TsAdd(struct timespec ts1, struct timespec ts2) {
     return tr;
 }
 
-void save_audio_to_wav(const char* filename, Uint8* buffer, Uint32 buffer_size, int sample_rate);
+void save_audio_to_wav(const char* filename, const Uint8* buffer, Uint32 buffer_size, int sample_rate);
 
 /* ***********************************************
 * Global variables
 * ***********************************************/
 cab cab_buffer;
+cab filt_cab;                 // Blocks filtered by the Preprocessing thread
+spectrumBuffer spec_buffer;   // Latest amplitude spectrum, shared by the analysis threads
+stft speed_stft;              // Filtered stream, overlapped frames for the Speed thread
+rtArena rtArenaMain;          // Task states, allocated and touched at startup
+uint32_t blocksLost = 0;      // Captured blocks the Preprocessing thread never got (seq gaps)
+int outSpeed = -1, outIssue = -1, outDirection = -1;  // Capture-to-decision statistics (rt/stats.h)
+
+// Preprocessing filter chain (biquads applied in order, see dsp/iir.h)
+const biquadConfig preprocChain[] = {
+    { BIQUAD_HP,    20.0, 0.707 },  // DC offset and rumble
+    { BIQUAD_NOTCH, 50.0, 10.0  },  // Mains hum
+};
+
 SDL_AudioDeviceID recordingDeviceId = 0;  
+const char *captureSpec = NULL;   // -capture: headless source (NULL: SDL device)
+int captureFast = 0, captureLoop = 0;
+capture headless;
+rtNotify *captureAck = NULL;      // -fast: next block once published (set in main)
+sampleRing captureRing;           // Capture periods as they arrive, cut in frames by the Assembler task
+int frameN = ABUFSIZE_SAMPLES;    // -frame: analysis frame (FFT size), power of 2
+int frameHop = 0;                 // -hop: samples between frame starts, 1 .. frameN (0: frameN)
+int capturePeriod = CAPTURE_PERIOD_SAMPLES;  // -period: samples per capture callback
+const char *shmName = RTDB_SHM_NAME;  // -shm: RTDB segment (NULL: -noshm)
+rtdbShm *rtdbExport = NULL;       // RTDB and latest spectrum, shared with the monitors (rtdbcat)
 Uint8 *gRecordingBuffer = NULL;
 SDL_AudioSpec gReceivedRecordingSpec;
 Uint32 gBufferBytePosition = 0, gBufferByteMaxPosition = 0, gBufferByteSize = 0;
 
 int gBytesPerSample = 0; // <-- new: bytes per audio frame (channels * bytes per sample)
 
-volatile float detectedSpeedFrequency = 0.0, maxAmplitudeDetected = 0.0;
-
-pthread_mutex_t updatedVarMutex = PTHREAD_MUTEX_INITIALIZER;
-pthread_cond_t updatedVar = PTHREAD_COND_INITIALIZER;
-sem_t data_ready;  // Semaphore for managing data readines
-
-FILE *gantt_logf;  // For Gantt data (gantt_log.csv)
-FILE *status_logf; // For Status reports (rtsounds_log.txt)
-pthread_mutex_t ganttLogMutex = PTHREAD_MUTEX_INITIALIZER;
-pthread_mutex_t statusLogMutex = PTHREAD_MUTEX_INITIALIZER;
+int displayPanel = -1, fftPanel = -1;  // Status panels (rt/render.h): terminal and STATUS_LOG_FILE
 /* *************************
-* Thread Functions
+* Task Functions
+* Each task is an entry of rtTasks (see main and rt/rttask.h): the
+* framework runs its init once, then its body once per release, and
+* records every job in the trace and the timing statistics.
 * *************************/
 
+// Source ended (feeder thread): stops the program as SIGINT would
+static void headlessEnd(void) {
+    kill(getpid(), SIGTERM);
+}
 
-void* Audio_thread(void* arg) {
-    // A thread de áudio da SDL é o verdadeiro produtor, chamando o callback.
-    // Esta thread serve apenas para iniciar a gravação e manter o RT agendamento.
-    
-    // Obter a prioridade para a mensagem de debug
-    int prio = ((struct sched_param*)arg)->sched_priority; 
-    printf("Audio Thread (Produtor) Running - Prio: %d\n", prio);
-    
-    // Inicia a gravação de áudio de forma contínua. 
+// A thread de áudio da SDL é o verdadeiro produtor, chamando o callback.
+// Esta tarefa inicia a gravação e verifica periodicamente que continua ativa.
+// Headless (-capture): the feeder thread of capture/ calls the same
+// callback instead, paced in real time or (-fast) by the end of the
+// jobs of the last task that handles every block (captureAck): -fast
+// delivers one hop per frame, the first ones until a frame is complete.
+// It is started by the first job, when the event-driven tasks already
+// wait for blocks (-fast waits for each block to be analysed)
+int Audio_init(rtTask *t) {
+    if (captureSpec != NULL) return 0;
+    // Inicia a gravação de áudio de forma contínua.
     // Isto faz com que a audioRecordingCallback seja chamada continuamente.
-    SDL_PauseAudioDevice(recordingDeviceId, SDL_FALSE); 
+    SDL_PauseAudioDevice(recordingDeviceId, SDL_FALSE);
+    return 0;
+}
 
-    // O trabalho pesado é delegado ao callback. Esta thread principal deve apenas esperar.
-    while (1) {
-        // Usa SDL_Delay para manter a thread viva sem consumir CPU excessivo
-        // (Embora não seja estritamente necessário num modelo RT em que outras threads correm)
-        SDL_Delay(1000); 
+int Audio_job(rtTask *t) {
+    if (captureSpec != NULL) {
+        if (headless.started) return RTTASK_IDLE;
+        if (captureStart(&headless, captureFast ? frameHop : capturePeriod, captureFast, captureLoop,
+                         captureAck, (frameN + frameHop - 1) / frameHop,
+                         audioRecordingCallback, NULL, headlessEnd) != 0) {
+            fprintf(stderr, "Cannot start the capture thread\n");
+            kill(getpid(), SIGTERM);
+        }
+        return 0;
     }
-    return NULL;
+    if (SDL_GetAudioDeviceStatus(recordingDeviceId) == SDL_AUDIO_PAUSED) {
+        SDL_PauseAudioDevice(recordingDeviceId, SDL_FALSE);
+    }
+    return 0;
 }
-// rtsounds.c
-// rtsounds.c
-// rtsounds.c
 
-void* Speed_thread(void* arg) {
-    const int N = ABUFSIZE_SAMPLES; 
-    complex double x[N]; 
-    float fk[N];
-    float Ak[N];
-
-    struct timespec period = {0, 200000000}; // 200ms
-    struct timespec next_wakeup;
+// Assembler task (event-driven): runs once per capture period written to
+// captureRing by the callback, and cuts from it every complete frame of
+// frameN samples, one every frameHop samples, into cab_buffer. The
+// capture period (-period) and the analysis frame (-frame, -hop) are
+// independent: a frame is published as soon as its last period arrives.
+// Every frame gets the next number even if no CAB slot is free (the
+// readers see the gap); its capture time is that of its last sample.
+typedef struct {
+    uint64_t next;         // Stream offset of the next frame
+} assemblerState;
+
+int Assembler_job(rtTask *t) {
+    assemblerState *s = t->ctx;
+    const int N = frameN;
+    uint64_t head = ringHead(&captureRing);
+    int frames = 0;
+
+    while (head - s->next >= (uint64_t)N) {
+        uint32_t seq = ++cab_buffer.captured;
+        buffer* writeBuffer = cab_getWriteBuffer(&cab_buffer);
+
+        if (writeBuffer != NULL) {
+            ringRead(&captureRing, s->next, writeBuffer->buf, N);
+            writeBuffer->seq = seq;
+            writeBuffer->sample = s->next;
+            ringTime(&captureRing, s->next + N - 1, &writeBuffer->ready);
+            cab_buffer.nblocks++;
+            cab_releaseWriteBuffer(&cab_buffer, writeBuffer->index);  // Releases the Preprocessing task
+        }
+        s->next += frameHop;
+        frames++;
+    }
+    ringRelease(&captureRing, s->next);  // The next frame starts there
+    cab_buffer.samples = head;
+    t->block = cab_buffer.captured;
+    return (frames > 0) ? 0 : RTTASK_IDLE;
+}
+// rtsounds.c
 
-    clock_gettime(CLOCK_MONOTONIC, &next_wakeup); 
+// Strongest bin below kmax of an amplitude spectrum, weighted by the LP response.
+// Its frequency is refined between bins with method m (see dsp/peak.h)
+static void speedPeak(const float *Ak, const float *lpGain, float *weighted, int kmax,
+                      peakMethod m, float *maxA, float *maxF) {
+    const int N = frameN;
+    int k;
+
+    kApplyWindow(Ak, lpGain, weighted, kmax + 1);
+    k = kArgmaxBand(weighted, 1, kmax);
+    *maxA = 0.0;
+    *maxF = 0.0;
+    if (weighted[k] > 0.0) {
+        *maxA = weighted[k];
+        *maxF = peakInterpolate(Ak, N/2 + 1, k, m, NULL) * SAMP_FREQ / N;
+    }
+}
 
-    int prio = ((struct sched_param*)arg)->sched_priority; 
-    printf("Speed Thread Running - Prio: %d\n", prio);
+typedef struct {
+    float lpGain[SPEC_BINS];   // LP filter response, applied to the shared (not low-passed) spectrum
+    float weighted[SPEC_BINS];
+    float frame[SPEC_BINS];    // Amplitude spectrum of one STFT frame
+    uint32_t lastVersion;
+    int kmax;                  // Last bin below MAX_FREQ_TO_CHECK
+} speedState;
+
+// Speed state, shared by Speed_init and the batch analysis
+static void speedSetup(speedState *s) {
+    const int N = frameN;
+    const float MAX_FREQ_TO_CHECK = COF + 50.0;
+    const float *fk = spec_buffer.fk;
+
+    s->lastVersion = 0;
+    s->kmax = 1;
+    for (int k = 0; k <= N/2; k++) {
+        s->lpGain[k] = filterLPGain(COF, SAMP_FREQ, fk[k]);
+        if (k > 0 && fk[k] < MAX_FREQ_TO_CHECK) s->kmax = k;
+    }
+}
 
-    while (1) {
-        next_wakeup = TsAdd(next_wakeup, period);
+int Speed_init(rtTask *t) {
+    speedSetup(t->ctx);
+    return 0;
+}
 
-        // --- GANTT: CAPTURE START TIME ---
-        struct timespec start_time, end_time;
-        clock_gettime(CLOCK_MONOTONIC, &start_time);
-        // --- END GANTT ---
+// Publishes one speed estimate: RTDB record and capture-to-decision latency
+static void speedPublish(float hz, float amp, uint32_t block, uint64_t sample,
+                         const struct timespec *captured) {
+    rtdbSpeed result = { hz, amp, block, 0, rtdbNs(captured), sample };
+    struct timespec decided;
 
-        //printf("DEBUG SPEED: Dados recebidos! A processar...\n"); 
-        
-        buffer* readBuffer = cab_getReadBuffer(&cab_buffer); 
+    clock_gettime(CLOCK_MONOTONIC, &decided);
+    rtdbSetSpeed(rtdbMain, &result, &decided);
+    statsOutput(outSpeed, block, captured, &decided);
+}
 
-        if (readBuffer != NULL) {
-            
-            filterLP(COF, SAMP_FREQ, (uint8_t*)readBuffer->buf, N);
+// With SPEED_STFT_HOP > 0 the task transforms every overlapped frame of
+// speed_stft that ends in the latest block or before, and publishes one
+// estimate per frame (every hop samples), tagged with the capture of
+// the frame's last sample. The frames that start before the stream
+// last restarted (samples lost before Preprocessing) are skipped: they
+// join audio from both sides of the gap, or are older than it, and
+// their samples can no longer be located in the capture. Otherwise it
+// reads the latest block spectrum from spec_buffer: one estimate per block.
+int Speed_job(rtTask *t) {
+    const int N = frameN;
+    speedState *s = t->ctx;
+    float maxA = 0.0, maxF = 0.0;
+
+    //printf("DEBUG SPEED: Dados recebidos! A processar...\n"); 
+
+    // Latest block: its samples are streamed to speed_stft before it is
+    // published, so the frames up to spec->stftHead are complete
+    const spectrum* spec = spec_getReadBuffer(&spec_buffer);
+    if (spec == NULL) {
+        t->block = s->lastVersion;
+        return 0;
+    }
 
-            for (int k = 0; k < N; k++) {
-                double centered_sample = (double)readBuffer->buf[k] - 32768.0; 
-                x[k] = centered_sample + 0.0 * I;
+    if (SPEED_STFT_HOP > 0 && spec->version != 0) {
+        unsigned end;
+        while ((int)(spec->stftHead - (end = stftNextEnd(&speed_stft))) >= 0) {
+            if ((int)(end - N - spec->stftRestart) < 0) {  // Starts before the restart
+                if (!stftSkip(&speed_stft)) break;
+                continue;
             }
-            
-            cab_releaseReadBuffer(&cab_buffer, readBuffer->index); 
-
-            fftCompute(x, N);
-            fftGetAmplitude(x, N, SAMP_FREQ, fk, Ak);
-            
-            float maxA = 0.0;
-            float maxF = 0.0;
-            const float MAX_FREQ_TO_CHECK = COF + 50.0;
-
-            for(int k=1; k<=N/2; k++) {
-                if (Ak[k] > maxA && fk[k] < MAX_FREQ_TO_CHECK) {
-                    maxA = Ak[k];
-                    maxF = fk[k];
-                }
-            }
-            
-            pthread_mutex_lock(&updatedVarMutex);
-            detectedSpeedFrequency = maxF;
-            maxAmplitudeDetected = maxA;
-            pthread_mutex_unlock(&updatedVarMutex);
-            
-            //printf("DEBUG SPEED: Max Freq=%.2f Hz, Max Amp=%.2f (Loop concluído)\n", maxF, maxA);
-        }
-        
-        // --- GANTT: CAPTURE END TIME & LOG ---
-        clock_gettime(CLOCK_MONOTONIC, &end_time);
-        pthread_mutex_lock(&ganttLogMutex); // Use GANTT mutex
-        gantt_logf = fopen("gantt_log.csv", "a"); // Log to CSV
-        if (gantt_logf) {
-            fprintf(gantt_logf, "GANTT,Speed_thread,%d,%ld,%ld,%ld,%ld\n", 
-                    prio, start_time.tv_sec, start_time.tv_nsec, 
-                    end_time.tv_sec, end_time.tv_nsec);
-            fclose(gantt_logf);
+            if (!stftFrame(&speed_stft, s->frame)) break;
+
+            // Contiguous since the restart: the frame ends stftHead - end
+            // samples before the block. Its capture time is that of its
+            // last sample, or the block's if the ring cannot tell it
+            uint64_t sample = spec->sample + N - 1 - (spec->stftHead - end);
+            struct timespec captured = spec->ready;
+            ringTime(&captureRing, sample, &captured);
+            speedPeak(s->frame, s->lpGain, s->weighted, s->kmax, PEAK_GAUSSIAN, &maxA, &maxF); // Hann frames
+            speedPublish(maxF, maxA, spec->version, sample, &captured);
         }
-        pthread_mutex_unlock(&ganttLogMutex);
-        // --- END GANTT ---
-        
-        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next_wakeup, NULL); 
+        s->lastVersion = spec->version;
+    } else if (spec->version != s->lastVersion) { // Skip if no new block since last run
+        speedPeak(spec->Ak, s->lpGain, s->weighted, s->kmax, PEAK_RECT, &maxA, &maxF); // Unwindowed block
+        speedPublish(maxF, maxA, spec->version, spec->sample + N - 1, &spec->ready);
+        s->lastVersion = spec->version;
     }
-    return NULL;
+    spec_releaseReadBuffer(&spec_buffer, spec->index);
+    //printf("DEBUG SPEED: Max Freq=%.2f Hz, Max Amp=%.2f (Loop concluído)\n", maxF, maxA);
+
+    t->block = s->lastVersion;
+    return 0;
 }
 // Adicionar ao lado das outras thread functions
 // rtsounds.c
 
-void* Display_thread(void* arg) {
-    struct timespec period = {5, 0}; // 5 seconds
-    struct timespec next_wakeup;
-    clock_gettime(CLOCK_MONOTONIC, &next_wakeup); 
-
-    int prio = ((struct sched_param*)arg)->sched_priority;
-    //printf("Display Thread Running - Prio: %d, Period: 5s\n", prio);
-
-    while (1) {
-        next_wakeup = TsAdd(next_wakeup, period);
-        
-        // --- GANTT: CAPTURE START TIME ---
-        struct timespec start_time, end_time;
-        clock_gettime(CLOCK_MONOTONIC, &start_time);
-        // --- END GANTT ---
-
-        float speedFreq = 0.0;
-        float maxAmp = 0.0;
-        int isIssue = 0;
-        int direction = 0; 
-        float issueR = 0.0;
-
-        pthread_mutex_lock(&updatedVarMutex);
-        speedFreq = detectedSpeedFrequency;
-        maxAmp = maxAmplitudeDetected;
-        isIssue = issueDetected; 
-        direction = directionValue; 
-        issueR = issueRatio;
-        pthread_mutex_unlock(&updatedVarMutex);
-
-        const char *issueStatus = isIssue ? "FAULT DETECTED! (High Prio 60)" : "OK";
-        const char *dirStatus = (direction == 1) ? "FORWARD (Accelerating)" : 
-                                (direction == -1) ? "REVERSE (Decelerating)" : 
-                                (direction == 2) ? "STABLE (Constant Speed)" :
-                                "STOPPED";
-        
-        // --- Print to Console ---
-        printf("===========================================\n");
-        printf(" REAL-TIME MONITORING SYSTEM (Prio %d)\n", prio);
-        printf("===========================================\n");
-        printf(" [TASK STATUS]\n");
-        printf(" SPEED (Prio 40): \t%.2f Hz\n", speedFreq);
-        printf(" ISSUE (Prio 60): \t%s\n", issueStatus);
-        printf(" DIRECTION (Prio 50): \t%s\n", dirStatus);
-        printf("===========================================\n");
-        printf(" [DEBUG]\n");
-        printf(" Speed Thread Max Amplitude: \t%.2f\n", maxAmp);
-        printf(" Issue Thread Ratio: \t\t%.2f\n", issueR); 
-        printf("===========================================\n\n");
-
-        // --- Print to Status Log File (rtsounds_log.txt) ---
-        pthread_mutex_lock(&statusLogMutex);
-        status_logf = fopen("rtsounds_log.txt", "a");
-        if (status_logf) {
-            fprintf(status_logf, "===========================================\n");
-            fprintf(status_logf, " REAL-TIME MONITORING SYSTEM (Prio %d)\n", prio);
-            fprintf(status_logf, "===========================================\n");
-            fprintf(status_logf, " [TASK STATUS]\n");
-            fprintf(status_logf, " SPEED (Prio 40): \t%.2f Hz\n", speedFreq);
-            fprintf(status_logf, " ISSUE (Prio 60): \t%s\n", issueStatus);
-            fprintf(status_logf, " DIRECTION (Prio 50): \t%s\n", dirStatus);
-            fprintf(status_logf, "===========================================\n");
-            fprintf(status_logf, " [DEBUG]\n");
-            fprintf(status_logf, " Speed Thread Max Amplitude: \t%.2f\n", maxAmp);
-            fprintf(status_logf, " Issue Thread Ratio: \t\t%.2f\n", issueR); 
-            fprintf(status_logf, "===========================================\n\n");
-            fflush(status_logf);
-            fclose(status_logf);
-        }
-        pthread_mutex_unlock(&statusLogMutex);
-        // --- End Status Log ---
-
-        // --- GANTT: CAPTURE END TIME & LOG ---
-        clock_gettime(CLOCK_MONOTONIC, &end_time);
-        pthread_mutex_lock(&ganttLogMutex); // Use GANTT mutex
-        gantt_logf = fopen("gantt_log.csv", "a"); // Log to CSV
-        if (gantt_logf) {
-            fprintf(gantt_logf, "GANTT,Display_thread,%d,%ld,%ld,%ld,%ld\n", 
-                    prio, start_time.tv_sec, start_time.tv_nsec, 
-                    end_time.tv_sec, end_time.tv_nsec);
-            fclose(gantt_logf);
-        }
-        pthread_mutex_unlock(&ganttLogMutex);
-        // --- END GANTT ---
-
-        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next_wakeup, NULL); 
+int Display_job(rtTask *t) {
+    int prio = t->prio;
+    rtdbSpeed speed;
+    rtdbIssue issue;
+    rtdbDirection dir;
+    uint64_t updated[3];   // Of speed, issue, direction (ns)
+    struct timespec now;
+
+    // Each record is a consistent copy of one update of its task
+    rtdbGetSpeed(rtdbMain, &speed, &updated[0]);
+    rtdbGetIssue(rtdbMain, &issue, &updated[1]);
+    rtdbGetDirection(rtdbMain, &dir, &updated[2]);
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    float speedFreq = speed.hz;
+    float maxAmp = speed.amplitude;
+    int isIssue = issue.fault;
+    int direction = dir.direction;
+    float issueR = issue.ratio;
+    uint32_t blocks[3] = { speed.block, issue.block, dir.block };  // Source blocks
+    double age[3];         // Since the last update (ms), -1: none yet
+    for (int i = 0; i < 3; i++) {
+        age[i] = (updated[i] > 0) ? (rtdbNs(&now) - updated[i]) / 1e6 : -1.0;
     }
-    return NULL;
+
+    const char *issueStatus = isIssue ? "FAULT DETECTED! (High Prio 60)" : "OK";
+    const char *dirStatus = (direction == 1) ? "FORWARD (Accelerating)" : 
+                            (direction == -1) ? "REVERSE (Decelerating)" : 
+                            (direction == 2) ? "STABLE (Constant Speed)" :
+                            "STOPPED";
+    
+    // --- Formatted once; the render writer prints it and appends it to the log ---
+    renderFrame *f = renderBegin(displayPanel);
+    if (f == NULL) return 0;
+    renderf(f, "===========================================\n");
+    renderf(f, " REAL-TIME MONITORING SYSTEM (Prio %d)\n", prio);
+    renderf(f, "===========================================\n");
+    renderf(f, " [TASK STATUS]\n");
+    renderf(f, " SPEED (Prio 40): \t%.2f Hz\n", speedFreq);
+    renderf(f, " ISSUE (Prio 60): \t%s\n", issueStatus);
+    renderf(f, " DIRECTION (Prio 50): \t%s\n", dirStatus);
+    renderf(f, " (source blocks: speed %u, issue %u, direction %u)\n", blocks[0], blocks[1], blocks[2]);
+    renderf(f, " (updated: %.0f, %.0f, %.0f ms ago)\n", age[0], age[1], age[2]);
+    renderf(f, "===========================================\n");
+    renderf(f, " [DEBUG]\n");
+    renderf(f, " Speed Thread Max Amplitude: \t%.2f\n", maxAmp);
+    renderf(f, " Issue Thread Ratio: \t\t%.2f\n", issueR);
+    renderf(f, "===========================================\n");
+    renderWith(f, statsFormat);
+    renderf(f, "===========================================\n\n");
+    renderPublish(displayPanel, f);
+    return 0;
 }
 // rtsounds.c
 
-// **************** Lógica da Thread 3: Issue ****************
+// **************** Lógica da Tarefa 3: Issue ****************
 // rtsounds.c
 
-// Variáveis globais (RTDB) necessárias para a Issue Thread (adicionar em rtsounds.h)
-// volatile float detectedIssueFrequency = 0.0;
-// volatile float issueRatio = 0.0; 
-// volatile int issueDetected = 0;
+// Result: rtdbMain->issue (see rtsounds.h)
 
-// rtsounds.c
+typedef struct {
+    uint32_t lastVersion;
+    int kThr;              // First bin at or above ISSUE_FREQ_THRESHOLD
+} issueState;
 
-void* Issue_thread(void* arg) {
-    const int N = ABUFSIZE_SAMPLES; 
+// Issue state, shared by Issue_init and the batch analysis
+static void issueSetup(issueState *s) {
+    const int N = frameN;
     const int ISSUE_FREQ_THRESHOLD = 2000; 
-    
-    complex double x[N]; 
-    float fk[N];
-    float Ak[N];
-    
-    struct timespec period = {1, 0}; // 1.0 s
-    struct timespec next_wakeup;
-    clock_gettime(CLOCK_MONOTONIC, &next_wakeup); 
-
-    int prio = ((struct sched_param*)arg)->sched_priority;
-    printf("Issue Thread Running - Prio: %d\n", prio);
-
-    while (1) {
-        next_wakeup = TsAdd(next_wakeup, period);
-        
-        // --- GANTT: CAPTURE START TIME ---
-        struct timespec start_time, end_time;
-        clock_gettime(CLOCK_MONOTONIC, &start_time);
-        // --- END GANTT ---
-
-        buffer* readBuffer = cab_getReadBuffer(&cab_buffer); 
-
-        if (readBuffer != NULL) {
-            
-            for (int k = 0; k < N; k++) {
-                double centered_sample = (double)readBuffer->buf[k] - 32768.0; 
-                x[k] = centered_sample + 0.0 * I;
-            }
-            
-            cab_releaseReadBuffer(&cab_buffer, readBuffer->index); 
-
-            fftCompute(x, N);
-            fftGetAmplitude(x, N, SAMP_FREQ, fk, Ak);
-            
-            float maxHighFreqAmp = 0.0;
-            float maxSpeedAmp = 0.0; 
-            float currentIssueFreq = 0.0;
-
-            for (int k = 1; k <= N/2; k++) {
-                if (fk[k] >= ISSUE_FREQ_THRESHOLD && Ak[k] > maxHighFreqAmp) {
-                    maxHighFreqAmp = Ak[k];
-                    currentIssueFreq = fk[k];
-                }
-                if (fk[k] < ISSUE_FREQ_THRESHOLD && Ak[k] > maxSpeedAmp) {
-                    maxSpeedAmp = Ak[k];
-                }
-            }
-            
-            float ratio = (maxSpeedAmp > 0) ? (maxHighFreqAmp / maxSpeedAmp) : 0.0;
-            int issueFound = (ratio > 0.15 && maxHighFreqAmp > 8000.0); 
-
-            pthread_mutex_lock(&updatedVarMutex);
-            detectedIssueFrequency = currentIssueFreq;
-            issueRatio = ratio;
-            issueDetected = issueFound;
-            pthread_mutex_unlock(&updatedVarMutex);
-            
-           // printf("DEBUG ISSUE (Prio %d): High Amp=%.2f, Ratio=%.2f (Falha: %s)\n", prio, maxHighFreqAmp, ratio, issueFound ? "SIM" : "NÃO");
-        } else {
-            //printf("DEBUG ISSUE (Prio %d): Sem buffer disponível, ignorando ciclo.\n", prio);
-        }
-        
-        // --- GANTT: CAPTURE END TIME & LOG ---
-        clock_gettime(CLOCK_MONOTONIC, &end_time);
-        pthread_mutex_lock(&ganttLogMutex); // Use GANTT mutex
-        gantt_logf = fopen("gantt_log.csv", "a"); // Log to CSV
-        if (gantt_logf) {
-            fprintf(gantt_logf, "GANTT,Issue_thread,%d,%ld,%ld,%ld,%ld\n", 
-                    prio, start_time.tv_sec, start_time.tv_nsec, 
-                    end_time.tv_sec, end_time.tv_nsec);
-            fclose(gantt_logf);
+    const float *fk = spec_buffer.fk;
+
+    s->lastVersion = 0;
+    s->kThr = N/2 + 1;
+    for (int k = N/2; k >= 1 && fk[k] >= ISSUE_FREQ_THRESHOLD; k--) {
+        s->kThr = k;
+    }
+}
+
+int Issue_init(rtTask *t) {
+    issueSetup(t->ctx);
+    return 0;
+}
+
+// Issue decision for one block: the strongest component above the
+// threshold against the strongest one of the speed band, both from the
+// amplitude spectrum Ak of the block (shared with Speed and FFT, so
+// the decision costs two band scans; a Goertzel bank over the same
+// bands costs more than the FFT, see bench/goertzel_bench).
+// Returns 1 if a fault is detected
+static int issueEvaluate(issueState *s, const float *Ak, float *issueFreq, float *issueRatioOut) {
+    const int N = frameN;
+    float maxHighFreqAmp = 0.0;
+    float maxSpeedAmp = 0.0;
+    float currentIssueFreq = 0.0;
+
+    if (s->kThr <= N/2) {
+        int k = kArgmaxBand(Ak, s->kThr, N/2);
+        if (Ak[k] > 0.0) {
+            maxHighFreqAmp = Ak[k];
+            currentIssueFreq = peakInterpolate(Ak, N/2 + 1, k, PEAK_RECT, NULL) * SAMP_FREQ / N;
         }
-        pthread_mutex_unlock(&ganttLogMutex);
-        // --- END GANTT ---
+    }
+    if (s->kThr > 1) {
+        int k = kArgmaxBand(Ak, 1, s->kThr - 1);
+        if (Ak[k] > 0.0) maxSpeedAmp = Ak[k];
+    }
 
-        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next_wakeup, NULL); 
+    float ratio = (maxSpeedAmp > 0) ? (maxHighFreqAmp / maxSpeedAmp) : 0.0;
+    *issueFreq = currentIssueFreq;
+    *issueRatioOut = ratio;
+    return (ratio > 0.15 && maxHighFreqAmp > 8000.0);
+}
+
+int Issue_job(rtTask *t) {
+    issueState *s = t->ctx;
+    float currentIssueFreq = 0.0;
+    float ratio = 0.0;
+    int issueFound = 0;
+    int fresh = 0;         // New block since the last run
+    struct timespec captured, decided;  // Of the source block, of the result
+
+    const spectrum* spec = spec_getReadBuffer(&spec_buffer); 
+
+    if (spec != NULL && spec->version != s->lastVersion) { // Skip if no new block since last run
+        s->lastVersion = spec->version;
+        captured = spec->ready;
+        issueFound = issueEvaluate(s, spec->Ak, &currentIssueFreq, &ratio);
+        fresh = 1;
     }
-    return NULL;
+    //else printf("DEBUG ISSUE (Prio %d): Sem buffer disponível, ignorando ciclo.\n", prio);
+    if (spec != NULL) spec_releaseReadBuffer(&spec_buffer, spec->index);
+
+    if (fresh) {
+        rtdbIssue result = { currentIssueFreq, ratio, issueFound, s->lastVersion, rtdbNs(&captured) };
+
+        clock_gettime(CLOCK_MONOTONIC, &decided);
+        rtdbSetIssue(rtdbMain, &result, &decided);
+        statsOutput(outIssue, s->lastVersion, &captured, &decided);
+
+       // printf("DEBUG ISSUE (Prio %d): Ratio=%.2f (Falha: %s)\n", prio, ratio, issueFound ? "SIM" : "NÃO");
+    }
+    t->block = s->lastVersion;
+    return 0;
 }
 
-// **************** Lógica da Thread 4: Direction ****************
+// **************** Lógica da Tarefa 4: Direction ****************
 // rtsounds.c
 
-void* Direction_thread(void* arg) {
-    const int N = ABUFSIZE_SAMPLES; 
-    
-    struct timespec period = {0, 500000000}; 
-    struct timespec next_wakeup;
-    clock_gettime(CLOCK_MONOTONIC, &next_wakeup); 
+typedef struct {
+    float prevSpeed;
+    float prevAmp;
+} directionState;
 
-    int prio = ((struct sched_param*)arg)->sched_priority;
-    //printf("Direction Thread Running - Prio: %d\n", prio);
+#define MIN_SPEED_RUNNING 50.0f
 
-    float prevSpeed = 0.0f;
-    float prevAmp = 0.0f;
-    
-    const float MIN_SPEED_RUNNING = 50.0f;
+// Direction from the speed now and DIRECTION_PERIOD_MS earlier:
+// 1 accelerating, -1 decelerating, 2 stable, 0 stopped (or changing
+// by less than the thresholds)
+static int directionClassify(float currentSpeed, float prevSpeed) {
     const float ACCEL_THRESHOLD = 20.0f;
     const float DECEL_THRESHOLD = 20.0f;
     const float STABLE_THRESHOLD = 10.0f;
+    float speedDelta = currentSpeed - prevSpeed;
 
-    while (1) {
-        next_wakeup = TsAdd(next_wakeup, period);
-
-        // --- GANTT: CAPTURE START TIME ---
-        struct timespec start_time, end_time;
-        clock_gettime(CLOCK_MONOTONIC, &start_time);
-        // --- END GANTT ---
-
-        float currentSpeed = 0.0f;
-        float currentAmp = 0.0f;
-
-        pthread_mutex_lock(&updatedVarMutex);
-        currentSpeed = detectedSpeedFrequency;
-        currentAmp = maxAmplitudeDetected;
-        pthread_mutex_unlock(&updatedVarMutex);
-
-        float speedDelta = currentSpeed - prevSpeed;
-        
-        int newDirection = 0;  
-        
-        if (currentSpeed < MIN_SPEED_RUNNING) {
-            newDirection = 0;
-        } 
-        else if (speedDelta > ACCEL_THRESHOLD) {
-            newDirection = 1;
-        } 
-        else if (speedDelta < -DECEL_THRESHOLD) {
-            newDirection = -1;
-        } 
-        else if (fabs(speedDelta) <= STABLE_THRESHOLD && currentSpeed >= MIN_SPEED_RUNNING) {
-            newDirection = 2;
-        }
+    if (currentSpeed < MIN_SPEED_RUNNING) {
+        return 0;
+    } 
+    else if (speedDelta > ACCEL_THRESHOLD) {
+        return 1;
+    } 
+    else if (speedDelta < -DECEL_THRESHOLD) {
+        return -1;
+    } 
+    else if (fabs(speedDelta) <= STABLE_THRESHOLD && currentSpeed >= MIN_SPEED_RUNNING) {
+        return 2;
+    }
+    return 0;
+}
+
+int Direction_job(rtTask *t) {
+    directionState *s = t->ctx;
 
-        pthread_mutex_lock(&updatedVarMutex);
-        directionValue = newDirection;
-        directionValues.lastFrequency = currentSpeed;
-        directionValues.lastAmplitude = currentAmp;
-        pthread_mutex_unlock(&updatedVarMutex);
-
-        prevSpeed = currentSpeed;
-        prevAmp = currentAmp;
-
-        const char *dirStr = (newDirection == 1) ? "ACCEL" : 
-                            (newDirection == -1) ? "DECEL" : 
-                            (currentSpeed < MIN_SPEED_RUNNING) ? "STOP" : "STABLE";
-        
-       // printf("DEBUG DIRECTION (Prio %d): Speed=%.1f Hz (Δ=%.1f), State=%s\n",
-        //       prio, currentSpeed, speedDelta, dirStr);
-
-        // --- GANTT: CAPTURE END TIME & LOG ---
-        clock_gettime(CLOCK_MONOTONIC, &end_time);
-        pthread_mutex_lock(&ganttLogMutex); // Use GANTT mutex
-        gantt_logf = fopen("gantt_log.csv", "a"); // Log to CSV
-        if (gantt_logf) {
-            fprintf(gantt_logf, "GANTT,Direction_thread,%d,%ld,%ld,%ld,%ld\n", 
-                    prio, start_time.tv_sec, start_time.tv_nsec, 
-                    end_time.tv_sec, end_time.tv_nsec);
-            fclose(gantt_logf);
+    rtdbSpeed speed;
+    struct timespec captured, decided;  // Of the block the speed comes from, of the result
+
+    rtdbGetSpeed(rtdbMain, &speed, NULL);  // Speed, amplitude and block of one update
+    float currentSpeed = speed.hz;
+    float currentAmp = speed.amplitude;
+    uint32_t block = speed.block;
+    captured = rtdbTimespec(speed.captured_ns);
+
+    int newDirection = directionClassify(currentSpeed, s->prevSpeed);
+    rtdbDirection result = { newDirection, currentSpeed, currentAmp, block, speed.captured_ns };
+
+    clock_gettime(CLOCK_MONOTONIC, &decided);
+    rtdbSetDirection(rtdbMain, &result, &decided);
+    if (block != 0) statsOutput(outDirection, block, &captured, &decided);
+    t->block = block;
+
+    s->prevSpeed = currentSpeed;
+    s->prevAmp = currentAmp;
+    return 0;
+}
+// **************** Lógica da Tarefa 6: FFT (ou 6ª Tarefa) ****************
+typedef struct {
+    float Ak_copy[SPEC_BINS];  // Peaks are removed from it as they are found
+} fftState;
+
+int FFT_job(rtTask *t) {
+    const int N = frameN;
+    const float *fk = spec_buffer.fk;
+    float *Ak_copy = ((fftState *)t->ctx)->Ak_copy;
+
+    const spectrum* spec = spec_getReadBuffer(&spec_buffer);
+    renderFrame *f = renderBegin(fftPanel);
+    if (f == NULL) {
+        if (spec != NULL) spec_releaseReadBuffer(&spec_buffer, spec->index);
+        return 0;
+    }
+
+    if (spec != NULL && spec->version != 0) {
+       // printf("DEBUG FFT: Processing spectrum of block %u for spectral analysis\n", spec->version);
+
+        // Peaks are removed from the copy as they are found; the slot is released before any output
+        memcpy(Ak_copy, spec->Ak, sizeof(((fftState *)t->ctx)->Ak_copy));
+        t->block = spec->version;
+        spec_releaseReadBuffer(&spec_buffer, spec->index);
+
+        // --- Formatted once; the render writer prints it and appends it to the log ---
+        renderf(f, "\n╔═══════════════════════════════════════════╗\n");
+        renderf(f, "║   SPECTRAL ANALYSIS (Top 5 Peaks)        ║\n");
+        renderf(f, "╠═══════════════════════════════════════════╣\n");
+
+        int peaks_found = 0;
+        for (int p = 0; p < 5; p++) {
+            int maxIdx = kArgmaxBand(Ak_copy, 1, N/2);
+            float maxA = Ak_copy[maxIdx];
+            if (maxA > 100.0) {
+                renderf(f, "║ Peak %d: %7.1f Hz  │  Amp: %10.1f    ║\n", p + 1, fk[maxIdx], maxA);
+                peaks_found++;
+            }
+            Ak_copy[maxIdx] = 0.0;
         }
-        pthread_mutex_unlock(&ganttLogMutex);
-        // --- END GANTT ---
+        if (peaks_found == 0) {
+            renderf(f, "║ No significant peaks detected (all < 100) ║\n");
+        }
+        renderf(f, "╚═══════════════════════════════════════════╝\n\n");
+    } else {
+        renderf(f, "DEBUG FFT: No spectrum available for spectral analysis\n");
+        if (spec != NULL) spec_releaseReadBuffer(&spec_buffer, spec->index);
+    }
+    renderPublish(fftPanel, f);
+    return 0;
+}
 
-        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next_wakeup, NULL);
+// Preprocessing task (event-driven): runs once per assembled frame. It
+// filters the frame with the preprocChain cascade into filt_cab, then
+// computes the amplitude spectrum of the filtered frame once and
+// publishes it in spec_buffer for the Speed, Issue and FFT tasks.
+// The filter runs along the stream: with overlapped frames (hop < N)
+// only the samples of a frame after the previous one filtered are
+// filtered, the others are kept from it (also after lost frames, if
+// they still overlap). The filter restarts only if samples were missed.
+typedef struct {
+    specComplex X[SPEC_BINS];  // Real-input FFT: bins DC .. fs/2 only
+    uint16_t filtered[BUF_SIZE];  // Latest filtered frame
+    uint32_t lastSeq;
+    uint64_t filteredEnd;      // Stream offset after the last filtered sample
+    unsigned stftRestart;      // Speed STFT position where the stream last restarted
+    iirFilter filter;
+    specFftPlan *plan;
+} preprocState;
+
+// Preprocessing state, shared by Preprocessing_init and the batch analysis
+static int preprocSetup(preprocState *s) {
+    s->lastSeq = 0;
+    if (iirInit(&s->filter, preprocChain, sizeof(preprocChain) / sizeof(preprocChain[0]), SAMP_FREQ) != 0) {
+        fprintf(stderr, "Preprocessing Thread: invalid filter chain\n");
+        return -1;
     }
-    return NULL;
+    s->plan = specFftPlanCreate(frameN); // Twiddles/bit-reversal computed once, outside the loop
+    if (s->plan == NULL) {
+        fprintf(stderr, "Preprocessing Thread: cannot create FFT plan\n");
+        return -1;
+    }
+    return 0;
 }
-// **************** Lógica da Thread 6: FFT (ou 6ª Thread) ****************
-void* FFT_thread(void* arg) {
-    const int N = ABUFSIZE_SAMPLES;
-    complex double x[N];
-    float fk[N];
-    float Ak[N];
-    
-    struct timespec period = {2, 0}; 
-    struct timespec next_wakeup;
-    clock_gettime(CLOCK_MONOTONIC, &next_wakeup);
-
-    int prio = ((struct sched_param*)arg)->sched_priority;
-   // printf("FFT Spectral Analysis Thread Running - Prio: %d\n", prio);
-
-    while (1) {
-        next_wakeup = TsAdd(next_wakeup, period);
-        
-        // --- GANTT: CAPTURE START TIME ---
-        struct timespec start_time, end_time;
-        clock_gettime(CLOCK_MONOTONIC, &start_time);
-        // --- END GANTT ---
-
-        buffer* readBuffer = cab_getReadBuffer(&cab_buffer);
-        
-        if (readBuffer != NULL) {
-           // printf("DEBUG FFT: Processing buffer %d for spectral analysis\n", readBuffer->index);
-
-            for (int k = 0; k < N; k++) {
-                double centered_sample = (double)readBuffer->buf[k] - 32768.0;
-                x[k] = centered_sample + 0.0 * I;
-            }
-            cab_releaseReadBuffer(&cab_buffer, readBuffer->index);
-
-            fftCompute(x, N);
-            fftGetAmplitude(x, N, SAMP_FREQ, fk, Ak);
-
-            // --- Print to Console AND Status Log ---
-            pthread_mutex_lock(&statusLogMutex);
-            status_logf = fopen("rtsounds_log.txt", "a");
-
-            printf("\n╔═══════════════════════════════════════════╗\n");
-            printf("║   SPECTRAL ANALYSIS (Top 5 Peaks)        ║\n");
-            printf("╠═══════════════════════════════════════════╣\n");
-            if (status_logf) {
-                fprintf(status_logf, "\n╔═══════════════════════════════════════════╗\n");
-                fprintf(status_logf, "║   SPECTRAL ANALYSIS (Top 5 Peaks)        ║\n");
-                fprintf(status_logf, "╠═══════════════════════════════════════════╣\n");
-            }
 
-            float Ak_copy[N/2 + 1];
-            for (int k = 0; k <= N/2; k++) Ak_copy[k] = Ak[k];
-
-            int peaks_found = 0;
-            for (int p = 0; p < 5; p++) {
-                float maxA = 0.0;
-                int maxIdx = 0;
-                for (int k = 1; k <= N/2; k++) {
-                    if (Ak_copy[k] > maxA) {
-                        maxA = Ak_copy[k];
-                        maxIdx = k;
-                    }
-                }
-                if (maxA > 100.0) {
-                    printf("║ Peak %d: %7.1f Hz  │  Amp: %10.1f    ║\n", p + 1, fk[maxIdx], maxA);
-                    if (status_logf) fprintf(status_logf, "║ Peak %d: %7.1f Hz  │  Amp: %10.1f    ║\n", p + 1, fk[maxIdx], maxA);
-                    peaks_found++;
-                }
-                Ak_copy[maxIdx] = 0.0;
-            }
-            if (peaks_found == 0) {
-                printf("║ No significant peaks detected (all < 100) ║\n");
-                if (status_logf) fprintf(status_logf, "║ No significant peaks detected (all < 100) ║\n");
-            }
-            
-            printf("╚═══════════════════════════════════════════╝\n\n");
-            if (status_logf) {
-                fprintf(status_logf, "╚═══════════════════════════════════════════╝\n\n");
-                fflush(status_logf);
-                fclose(status_logf);
-            }
-            pthread_mutex_unlock(&statusLogMutex);
-            // --- End Status Log ---
+int Preprocessing_init(rtTask *t) {
+    return preprocSetup(t->ctx);
+}
+
+// Filters the last fresh samples of a frame of N (fresh = N: all of it,
+// e.g. when it does not overlap the previous one) into s->filtered,
+// after the N - fresh samples of the previous frame that it overlaps
+static void preprocFilter(preprocState *s, const uint16_t *frame, int N, int fresh) {
+    memmove(s->filtered, s->filtered + fresh, (N - fresh) * sizeof(uint16_t));
+    iirProcessU16(&s->filter, frame + N - fresh, s->filtered + N - fresh, fresh, 32768.0);
+}
 
+// Spectrum of a filtered block, left in s->X
+static void preprocSpectrum(preprocState *s, const uint16_t *filtered) {
+    specConvertCenterU16(filtered, 32768.0, (specReal *)s->X, frameN); // Packs the samples for the real FFT
+    specFftExecutePacked(s->plan, s->X);
+}
+
+// Amplitude of s->X, same scaling as fftGetAmplitude: 2/N, 1/N for DC and fs/2
+static void preprocAmplitude(const preprocState *s, float *Ak) {
+    const int N = frameN;
+
+    specAmplitude(s->X, Ak, N/2 + 1, 2.0 / N);
+    Ak[0] *= 0.5;
+    Ak[N/2] *= 0.5;
+}
+
+int Preprocessing_job(rtTask *t) {
+    const int N = frameN;
+    preprocState *s = t->ctx;
+    const buffer* readBuffer = cab_getReadBuffer(&cab_buffer);
+    buffer* filtBuffer = NULL;
+
+    if (readBuffer != NULL && readBuffer->seq != s->lastSeq
+        && (filtBuffer = cab_getWriteBuffer(&filt_cab)) != NULL) {
+        struct timespec captured = readBuffer->ready;
+        uint64_t sample = readBuffer->sample;
+
+        uint32_t gap = readBuffer->seq - s->lastSeq - 1;  // Dropped at capture, or overwritten
+        int fresh = N;     // Samples not filtered yet
+
+        // The frames that were lost may leave an overlap (gap * hop < N):
+        // its samples are filtered already. Samples in between that were
+        // never filtered: the stream restarts
+        if (s->lastSeq != 0 && sample <= s->filteredEnd) {
+            fresh = (int)(sample + N - s->filteredEnd);
         } else {
-            printf("DEBUG FFT: No buffer available for spectral analysis\n");
+            iirReset(&s->filter);
+            if (SPEED_STFT_HOP > 0) s->stftRestart = stftHead(&speed_stft);
         }
+        s->filteredEnd = sample + N;
 
-        // --- GANTT: CAPTURE END TIME & LOG ---
-        clock_gettime(CLOCK_MONOTONIC, &end_time);
-        pthread_mutex_lock(&ganttLogMutex); // Use GANTT mutex
-        gantt_logf = fopen("gantt_log.csv", "a"); // Log to CSV
-        if (gantt_logf) {
-            fprintf(gantt_logf, "GANTT,FFT_thread,%d,%ld,%ld,%ld,%ld\n", 
-                    prio, start_time.tv_sec, start_time.tv_nsec, 
-                    end_time.tv_sec, end_time.tv_nsec);
-            fclose(gantt_logf);
-        }
-        pthread_mutex_unlock(&ganttLogMutex);
-        // --- END GANTT ---
+        blocksLost += gap;
+        s->lastSeq = readBuffer->seq;
+        t->release = captured;  // Publication of the block (for the stats)
+        t->block = s->lastSeq;
+
+        preprocFilter(s, readBuffer->buf, N, fresh);
+        cab_releaseReadBuffer(&cab_buffer, readBuffer->index);
+        memcpy(filtBuffer->buf, s->filtered, N * sizeof(uint16_t));
 
-        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next_wakeup, NULL);
+        preprocSpectrum(s, filtBuffer->buf);
+        if (SPEED_STFT_HOP > 0  // Stream for the Speed task; samples it has no room for are a gap too
+            && stftWriteU16(&speed_stft, filtBuffer->buf + N - fresh, fresh, 32768.0f) < fresh) {
+            s->stftRestart = stftHead(&speed_stft);
+        }
+        filtBuffer->seq = s->lastSeq;  // Same number, capture time and offset as the raw block
+        filtBuffer->ready = captured;
+        filtBuffer->sample = sample;
+        filt_cab.nblocks++;
+        cab_releaseWriteBuffer(&filt_cab, filtBuffer->index);
+
+        spectrum* spec = spec_getWriteBuffer(&spec_buffer);
+        if (spec != NULL) {
+            preprocAmplitude(s, spec->Ak);
+            if (rtdbExport != NULL) {  // Memory copy only, for the monitors
+                struct timespec now;
+                clock_gettime(CLOCK_MONOTONIC, &now);
+                rtdbShmSetSpectrum(rtdbExport, spec->Ak, N/2 + 1, (float)SAMP_FREQ / N, s->lastSeq,
+                                   &captured, &now);
+            }
+            spec->version = s->lastSeq;
+            spec->ready = captured;
+            spec->sample = sample;
+            spec->stftHead = (SPEED_STFT_HOP > 0) ? stftHead(&speed_stft) : 0;
+            spec->stftRestart = s->stftRestart;
+            spec_releaseWriteBuffer(&spec_buffer, spec->index);
+        }
+        return 0;
     }
-    return NULL;
+
+    // Block already done when woken for it (we were late): nothing to do
+    if (readBuffer != NULL) cab_releaseReadBuffer(&cab_buffer, readBuffer->index);
+    t->block = s->lastSeq;
+    return RTTASK_IDLE;
 }
 
-// Add Preprocessing thread function
-void* Preprocessing_thread(void* arg) {
-    struct timespec period = {0, 150000000}; // 150 ms
-    struct timespec next_wakeup;
-    clock_gettime(CLOCK_MONOTONIC, &next_wakeup);
+/* *************************
+* Batch analysis (-batch)
+* The Preprocessing, Speed, Issue and Direction logic of the tasks,
+* run block by block over a recording by the workers of batch/batch.h
+* (frames of -frame samples, not overlapped). Each worker has its own
+* filter, FFT plan and Speed STFT; Direction compares the speed with the
+* one DIRECTION_PERIOD_MS of blocks earlier (the Direction task compares
+* it with its previous job).
+* *************************/
+#define DIRECTION_MAX_LAG 128  // Blocks in DIRECTION_PERIOD_MS, at the smallest frame
 
-    int prio = ((struct sched_param*)arg)->sched_priority;
-    printf("Preprocessing Thread (Disabled) Running - Prio: %d\n", prio);
+// Blocks of N samples in DIRECTION_PERIOD_MS (at least 1)
+static int directionLag(int N) {
+    int lag = (int)((2L * DIRECTION_PERIOD_MS * SAMP_FREQ / (1000L * N) + 1) / 2);
+    return (lag < 1) ? 1 : (lag > DIRECTION_MAX_LAG) ? DIRECTION_MAX_LAG : lag;
+}
 
-    while (1) {
-        next_wakeup = TsAdd(next_wakeup, period);
+// Speed STFT hop: SPEED_STFT_HOP, at most the frame
+static int speedStftHop(int N) {
+    return (SPEED_STFT_HOP < N) ? SPEED_STFT_HOP : N;
+}
+
+typedef struct {
+    preprocState pre;
+    speedState speed;
+    issueState issue;
+    stft speedStft;
+    float Ak[SPEC_BINS];
+    float speedHistory[DIRECTION_MAX_LAG];  // Last speeds, ring of lag
+    int lag;
+    uint32_t nblocks;                       // Since the last reset
+} batchState;
+
+static int batchInit(void *state) {
+    batchState *b = state;
+
+    if (preprocSetup(&b->pre) != 0) return -1;
+    speedSetup(&b->speed);
+    issueSetup(&b->issue);
+    b->lag = directionLag(frameN);
+    if (SPEED_STFT_HOP > 0
+        && stftInit(&b->speedStft, frameN, speedStftHop(frameN), SPEED_STFT_RING) != 0) {
+        fprintf(stderr, "Batch: cannot initialize the Speed STFT (hop %d)\n", speedStftHop(frameN));
+        return -1;
+    }
+    return 0;
+}
 
-        // --- GANTT: CAPTURE START TIME ---
-        struct timespec start_time, end_time;
-        clock_gettime(CLOCK_MONOTONIC, &start_time);
-        // --- END GANTT ---
+static void batchReset(void *state) {
+    batchState *b = state;
 
-        // This thread is disabled.
-        // We log its start and end time around the sleep.
+    iirReset(&b->pre.filter);
+    if (SPEED_STFT_HOP > 0) stftReset(&b->speedStft);
+    memset(b->speedHistory, 0, sizeof(b->speedHistory));
+    b->nblocks = 0;
+}
 
-        // --- GANTT: CAPTURE END TIME & LOG ---
-        clock_gettime(CLOCK_MONOTONIC, &end_time);
-        pthread_mutex_lock(&ganttLogMutex); // Use GANTT mutex
-        gantt_logf = fopen("gantt_log.csv", "a"); // Log to CSV
-        if (gantt_logf) {
-            fprintf(gantt_logf, "GANTT,Preproc_thread,%d,%ld,%ld,%ld,%ld\n", 
-                    prio, start_time.tv_sec, start_time.tv_nsec, 
-                    end_time.tv_sec, end_time.tv_nsec);
-            fclose(gantt_logf);
+static void batchBlock(void *state, const uint16_t *x, batchResult *r) {
+    const int N = frameN;
+    batchState *b = state;
+    float maxA = 0.0, maxF = 0.0;
+
+    // Preprocessing
+    preprocFilter(&b->pre, x, N, N);
+    preprocSpectrum(&b->pre, b->pre.filtered);
+    preprocAmplitude(&b->pre, b->Ak);
+
+    // Speed: one result per block, from the last overlapped frame that
+    // ends in it (the older ones are not transformed)
+    if (SPEED_STFT_HOP > 0) {
+        stftWriteU16(&b->speedStft, b->pre.filtered, N, 32768.0f);
+        if (stftLatest(&b->speedStft, b->speed.frame)) {
+            speedPeak(b->speed.frame, b->speed.lpGain, b->speed.weighted, b->speed.kmax, PEAK_GAUSSIAN, &maxA, &maxF);
         }
-        pthread_mutex_unlock(&ganttLogMutex);
-        // --- END GANTT ---
+    } else {
+        speedPeak(b->Ak, b->speed.lpGain, b->speed.weighted, b->speed.kmax, PEAK_RECT, &maxA, &maxF);
+    }
+    r->speedHz = maxF;
+    r->speedAmp = maxA;
+
+    // Issue
+    r->issue = issueEvaluate(&b->issue, b->Ak, &r->issueHz, &r->issueRatio);
 
-        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next_wakeup, NULL);
+    // Direction
+    float *lagged = &b->speedHistory[b->nblocks % b->lag];
+    r->direction = directionClassify(maxF, *lagged);
+    *lagged = maxF;
+    b->nblocks++;
+}
+
+static void batchDestroy(void *state) {
+    batchState *b = state;
+
+    if (SPEED_STFT_HOP > 0) stftDestroy(&b->speedStft);
+    specFftPlanDestroy(b->pre.plan);
+}
+
+static batchAnalyzer rtsoundsAnalyzer = {
+    sizeof(batchState), batchInit, batchReset, batchBlock, batchDestroy, 0
+};
+
+// Runs the batch analysis of a recording (no real-time task) and prints
+// the throughput
+static int runBatch(const char *wavPath, const char *outPath, int jobs) {
+    batchReport rep;
+
+    kernelsInit();
+    init_spectrumBuffer(&spec_buffer, frameN, SAMP_FREQ);  // Bin frequencies
+    rtsoundsAnalyzer.warmupBlocks = directionLag(frameN);  // Speed history of Direction
+    if (batchRun(wavPath, outPath, SAMP_FREQ, frameN, jobs, &rtsoundsAnalyzer, &rep) != 0) {
+        return 1;
+    }
+    batchPrintReport(stdout, &rep);
+    printf("Results of %llu blocks in %s\n", (unsigned long long)rep.blocks, outPath);
+    return 0;
+}
+
+// Task table, in the order of the -prio arguments. Adding an analysis
+// task is one entry here (and its init/job functions above).
+//   name, period (ms, event-driven: minimum inter-arrival), offset,
+//   deadline (ms, 0: period), prio, cpu (-1: any), event (NULL: periodic),
+//   every (event-driven: one job per every publications), init, body,
+//   state size (taken from rtArenaMain, zeroed), stack (KB, 0: RTTASK_STACK_KB)
+rtTask rtTasks[] = {
+    { "Audio_thread",     1000,                                 0, 0,                   80, -1, NULL,                0,                Audio_init,         Audio_job,         0,                      0 },
+    { "Preproc_thread",   BLOCK_PERIOD_MS,                      0, PREPROC_DEADLINE_MS, 45, -1, &cab_buffer.notify,  1,                Preprocessing_init, Preprocessing_job, sizeof(preprocState),   0 },
+    { "Speed_thread",     BLOCK_PERIOD_MS,                      0, 0,                   40, -1, &spec_buffer.notify, 1,                Speed_init,         Speed_job,         sizeof(speedState),     0 },
+    { "Issue_thread",     BLOCK_PERIOD_MS,                      0, 0,                   60, -1, &spec_buffer.notify, 1,                Issue_init,         Issue_job,         sizeof(issueState),     0 },
+    { "Direction_thread", DIRECTION_PERIOD_MS,                  0, 0,                   50, -1, NULL,                0,                NULL,               Direction_job,     sizeof(directionState), 0 },
+    { "Display_thread",   5000,                                 0, 0,                   30, -1, NULL,                0,                NULL,               Display_job,       0,                      0 },
+    { "FFT_thread",       FFT_EVERY_BLOCKS * BLOCK_PERIOD_MS,   0, 0,                   20, -1, &spec_buffer.notify, FFT_EVERY_BLOCKS, NULL,               FFT_job,           sizeof(fftState),       0 },
+    { "Assembler_thread", 0,                                    0, 0,                   70, -1, &captureRing.notify, 1,                NULL,               Assembler_job,     sizeof(assemblerState), 0 },
+};
+#define NRTTASKS ((int)(sizeof(rtTasks) / sizeof(rtTasks[0])))
+#define PACING_TASK 2  // Speed_thread: lowest priority of the per-block tasks (-fast)
+
+// Periods of the tasks released by the blocks, for the frame hop and
+// capture period chosen at run time (the table has the defaults). The
+// tasks released by every n-th block keep their period in ms.
+static void setBlockRate(void) {
+    int blockMs = (int)((1000L * frameHop + SAMP_FREQ / 2) / SAMP_FREQ);
+    int periodMs = (int)((1000L * capturePeriod + SAMP_FREQ / 2) / SAMP_FREQ);
+
+    if (blockMs < 1) blockMs = 1;
+    for (int i = 0; i < NRTTASKS; i++) {
+        rtTask *t = &rtTasks[i];
+        if (t->event == &captureRing.notify) {
+            t->periodMs = (periodMs < 1) ? 1 : periodMs;
+        } else if (t->event == &cab_buffer.notify || t->event == &spec_buffer.notify) {
+            if (t->every > 1) {
+                t->every = (t->every * BLOCK_PERIOD_MS + blockMs / 2) / blockMs;
+                if (t->every < 1) t->every = 1;
+            }
+            t->periodMs = ((t->every > 0) ? t->every : 1) * blockMs;
+        }
     }
-    return NULL;
 }
 
 /* *************************
@@ -578,7 +810,7 @@ int initialize_sdl_audio(int index) {
     }
 
     SDL_AudioSpec desiredRecordingSpec = {
-        .freq = SAMP_FREQ, .format = FORMAT, .channels = MONO, .samples = ABUFSIZE_SAMPLES, .callback = audioRecordingCallback
+        .freq = SAMP_FREQ, .format = FORMAT, .channels = MONO, .samples = capturePeriod, .callback = audioRecordingCallback
     };
 
     int device_count = SDL_GetNumAudioDevices(SDL_TRUE);
@@ -612,62 +844,38 @@ int initialize_sdl_audio(int index) {
 
     return 0;
 }
-pthread_t thread1, thread2, thread3, thread4, thread5, thread6, thread7;
-struct sched_param parm1, parm2, parm3, parm4, parm5, parm6, parm7;
-pthread_attr_t attr1, attr2, attr3, attr4, attr5, attr6, attr7;
-
-int priorities[7];
-
-void usage() {
-    printf("Usage: ./rtsounds -prio [p1 p2 p3 p4 p5 p6 p7]\n");
-}
-
-void cleanup() {
-    SDL_CloseAudioDevice(recordingDeviceId);
-    SDL_Quit();
-}
 
-void handle_signal(int signal) {
-    cleanup();
-    exit(0);
-}
-// Audio callback is defined in the header file
 /* *************************
-* Main Function
+* Lists the SDL capture devices, asks for one and opens it
+* Returns 0, or 1 on error
 * *************************/
-int main(int argc, char *argv[]) {
-    // General vars
-    int err;
-    struct sched_param parm1 = {0}, parm2 = {0}, parm3 = {0}, 
-                       parm4 = {0}, parm5 = {0}, parm6 = {0}, parm7 = {0};
-    
-    unsigned char* procname1 = "AudioThread";
-    unsigned char* procname2 = "PreprocessingThread";
-    unsigned char* procname3 = "SpeedThread";
-    unsigned char* procname4 = "IssueThread";
-    unsigned char* procname5 = "DirectionThread";
-    unsigned char* procname6 = "DisplayThread";
-    unsigned char* procname7 = "FFTThread";
-    
-    // Parse priorities from command line
-    if (argc > 1) {
-        if (strcmp(argv[1], "-prio") == 0 && argc == 9) {
-            for(int i = 0; i < 7; i++) {
-                priorities[i] = atoi(argv[i+2]);
-            }
-        } else {
-            usage();
-            return 1;
-        }
-    }
-
-    // Initialize SDL
-    if (SDL_Init(SDL_INIT_AUDIO) < 0) {
-        fprintf(stderr, "SDL could not initialize! SDL Error: %s\n", SDL_GetError());
-        return 1;
+// Reads a device index from stdin. SIGINT/SIGTERM are blocked already
+// (main takes them with sigwait), so they are watched with a signalfd
+// meanwhile: returns -1 on one of them, at end of input or if the line
+// is not a number
+static int readDeviceIndex(const sigset_t *stopSignals, int *index) {
+    char line[64];
+    int sfd = signalfd(-1, stopSignals, SFD_CLOEXEC);
+    struct pollfd fds[2] = { { STDIN_FILENO, POLLIN, 0 }, { sfd, POLLIN, 0 } };
+    int ok = 0;
+
+    fflush(stdout);
+    while (poll(fds, (sfd >= 0) ? 2 : 1, -1) < 0 && errno == EINTR);
+    if (sfd >= 0 && (fds[1].revents & POLLIN)) {
+        struct signalfd_siginfo si;
+        if (read(sfd, &si, sizeof(si)) == sizeof(si)) printf("\nSignal %u: stopping\n", si.ssi_signo);
+    } else if (fgets(line, sizeof(line), stdin) == NULL) {
+        fprintf(stderr, "\nNo device selected (end of input)\n");
+    } else if (sscanf(line, "%d", index) != 1) {
+        fprintf(stderr, "Invalid device index!\n");
+    } else {
+        ok = 1;
     }
-    atexit(cleanup);
+    if (sfd >= 0) close(sfd);
+    return ok ? 0 : -1;
+}
 
+int select_sdl_device(const sigset_t *stopSignals) {
     // List and select audio devices
     int gRecordingDeviceCount = SDL_GetNumAudioDevices(SDL_TRUE);
     if (gRecordingDeviceCount < 1) {
@@ -682,8 +890,11 @@ int main(int argc, char *argv[]) {
 
     int index;
     printf("Choose audio device: ");
-    scanf("%d", &index);
     
+    // Ctrl-C and end of input quit
+    if (readDeviceIndex(stopSignals, &index) != 0) {
+        return 1;
+    }
     if (index < 0 || index >= gRecordingDeviceCount) {
         fprintf(stderr, "Invalid device index!\n");
         return 1;
@@ -694,219 +905,438 @@ int main(int argc, char *argv[]) {
         return 1;
     }
 
-    // Allocate recording buffer
-    gRecordingBuffer = (uint8_t *)malloc(gBufferByteSize);
-    memset(gRecordingBuffer, 0, gBufferByteSize);
+    return 0;
+}
 
-    // Initialize CAB buffer
-    init_cab(&cab_buffer);
-    printf("CAB Buffer Initialization:\n");
-    for (int i = 0; i < NTASKS + 1; i++) {
-        printf("Buffer %d: nusers=%d\n", i, cab_buffer.buflist[i].nusers);
+void usage() {
+    printf("Usage: ./rtsounds [-prio p1 .. p%d] [-cpu c1 .. c%d] [-frame N] [-hop H] [-period P]\n",
+           NRTTASKS, NRTTASKS);
+    printf("   pN: SCHED_FIFO priority, cN: CPU the thread runs on (-1: any) of\n");
+    for (int i = 0; i < NRTTASKS; i++) {
+        printf("   %d: %s (default %d, %d)\n", i + 1, rtTasks[i].name, rtTasks[i].prio, rtTasks[i].cpu);
     }
+    printf("   The SDL capture thread gets the priority and CPU of %s\n", rtTasks[0].name);
+    printf("   N: analysis frame (FFT size), power of 2, %d .. %d (default %d)\n",
+           FRAME_MIN_SAMPLES, BUF_SIZE, ABUFSIZE_SAMPLES);
+    printf("   H: samples between frames, 1 .. N (default N, no overlap)\n");
+    printf("   P: samples per capture callback (default %d), frames are cut from\n", CAPTURE_PERIOD_SAMPLES);
+    printf("   the captured stream as soon as complete\n");
+    printf("   -shm NAME: shared memory the results and the spectrum are exported\n");
+    printf("   to (default %s, read with ./rtdbcat), -noshm: not exported\n", RTDB_SHM_NAME);
+    printf("       ./rtsounds [...] -capture SOURCE [-fast] [-loop]\n");
+    printf("   Headless capture instead of an SDL device, SOURCE is one of\n");
+    printf("   wav:FILE (16-bit PCM, %d Hz), raw:FILE, raw:- (stdin, s16le mono),\n", SAMP_FREQ);
+    printf("   gen:S[:SECONDS] (signalgen scenario S, 0 .. 5). -fast: as fast as\n");
+    printf("   the analysis keeps up, -loop: restart the source at its end\n");
+    printf("       ./rtsounds -batch FILE.wav [-jobs J] [-results FILE]\n");
+    printf("   Offline analysis of a recording (16-bit PCM, %d Hz) on J worker\n", SAMP_FREQ);
+    printf("   threads (default: one per CPU), results in %s (frames of N,\n", BATCH_FILE);
+    printf("   not overlapped)\n");
+}
 
-    // semaphore initialization 
-    sem_init(&data_ready, 0, 0);
+struct timespec runStart;  // Start of the tasks (0: not started)
 
-    // Clear Gantt Log and write CSV header
-    gantt_logf = fopen("gantt_log.csv", "w");
-    if (gantt_logf) {
-        fprintf(gantt_logf, "# TaskName,Priority,StartSec,StartNsec,EndSec,EndNsec\n");
-        fclose(gantt_logf);
-    } else {
-        perror("Failed to open gantt_log.csv for writing");
-    }
+// CPU time of the whole process since the tasks started, and the part
+// spent in the task bodies (from the timing statistics)
+static void cpuReport(FILE *f) {
+    struct rusage ru;
+    struct timespec now;
+    taskStats ts;
+    double bodies = 0.0;
 
-    // Clear Status Log
-    status_logf = fopen("rtsounds_log.txt", "w");
-    if (status_logf) {
-        fprintf(status_logf, "RTSounds Log Initialized.\n\n");
-        fclose(status_logf);
-    } else {
-        perror("Failed to open rtsounds_log.txt for writing");
+    if (runStart.tv_sec == 0 || getrusage(RUSAGE_SELF, &ru) != 0) return;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    for (int i = 0; i < NRTTASKS; i++) {
+        if (statsSnapshot(rtTasks[i].statsId, &ts) == 0) bodies += ts.exec.sum / 1e9;
     }
 
-    // Set up signal handlers
-    signal(SIGINT, handle_signal);
-    signal(SIGTERM, handle_signal);
+    double wall = (now.tv_sec - runStart.tv_sec) + (now.tv_nsec - runStart.tv_nsec) / 1e9;
+    double user = ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6;
+    double sys = ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+    fprintf(f, "CPU time: %.2f s user + %.2f s system in %.1f s (%.1f%% of one CPU), "
+               "task bodies %.2f s\n", user, sys, wall, 100.0 * (user + sys) / wall, bodies);
+}
 
-    // Create threads with their priorities
-    // Thread 1: Audio
-    pthread_attr_init(&attr1);
-    pthread_attr_setinheritsched(&attr1, PTHREAD_EXPLICIT_SCHED);
-    pthread_attr_setschedpolicy(&attr1, SCHED_FIFO);
-    parm1.sched_priority = priorities[0];
-    pthread_attr_setschedparam(&attr1, &parm1);
-    err = pthread_create(&thread1, &attr1, Audio_thread, &parm1);
-    if (err != 0) {
-        fprintf(stderr, "Error creating Audio thread\n");
+// Runs at exit (end of main or error): stops the tasks, then capture,
+// then writes the trace
+void cleanup() {
+    if (captureSpec != NULL) captureStop(&headless);  // No new blocks
+    rtTaskStop(rtTasks, NRTTASKS);  // Each task ends after its current job
+    unsigned replaced = renderStop();  // Prints and logs the last frames
+    if (replaced > 0) fprintf(stderr, "Status: %u frames replaced before being written\n", replaced);
+    rtdbShmDestroy(rtdbExport, shmName);  // Monitors see it ended
+    rtdbExport = NULL;
+    rtdbMain = &rtdbLocal;
+    SDL_CloseAudioDevice(recordingDeviceId);
+    ringDestroy(&captureRing);  // No producer (callback) nor consumer (Assembler) left
+    unsigned dropped = traceStop();  // Writes the records still in the rings
+    if (dropped > 0) fprintf(stderr, "Trace: %u records dropped (rings full)\n", dropped);
+    for (int i = 0; i < NRTTASKS; i++) {
+        if (rtTasks[i].skipped > 0) {
+            fprintf(stderr, "%s: %llu releases skipped (overruns)\n", rtTasks[i].name,
+                    (unsigned long long)rtTasks[i].skipped);
+        }
+    }
+    if (captureSpec != NULL) captureReport(stdout, &headless);
+    if (cab_buffer.captured > 0) {
+        printf("Blocks: %u captured, %u analysed, %u lost before the analysis\n",
+               cab_buffer.captured, filt_cab.nblocks, blocksLost);
+        if (atomic_load(&captureRing.dropped) > 0) {
+            printf("Capture ring: %llu samples dropped (full)\n",
+                   (unsigned long long)atomic_load(&captureRing.dropped));
+        }
+        statsPrint(stdout);
+    }
+    cpuReport(stdout);
+    SDL_Quit();
+}
+// Audio callback is defined in the header file
+/* *************************
+* Main Function
+* *************************/
+int main(int argc, char *argv[]) {
+    const char *batchPath = NULL, *batchOut = BATCH_FILE;
+    int batchJobs = 0;
+
+    // Parse priorities and CPUs from command line
+    long ncpus = sysconf(_SC_NPROCESSORS_CONF);
+    for (int a = 1; a < argc; a++) {
+        if (strcmp(argv[a], "-prio") == 0 && a + NRTTASKS < argc) {
+            for(int i = 0; i < NRTTASKS; i++) {
+                rtTasks[i].prio = atoi(argv[++a]);
+            }
+        } else if (strcmp(argv[a], "-cpu") == 0 && a + NRTTASKS < argc) {
+            for(int i = 0; i < NRTTASKS; i++) {
+                rtTasks[i].cpu = atoi(argv[++a]);
+                if (rtTasks[i].cpu < -1 || rtTasks[i].cpu >= ncpus) {
+                    fprintf(stderr, "Invalid CPU %d for %s (0 .. %ld, -1: any)\n",
+                            rtTasks[i].cpu, rtTasks[i].name, ncpus - 1);
+                    return 1;
+                }
+            }
+        } else if (strcmp(argv[a], "-capture") == 0 && a + 1 < argc) {
+            captureSpec = argv[++a];
+        } else if (strcmp(argv[a], "-fast") == 0) {
+            captureFast = 1;
+        } else if (strcmp(argv[a], "-loop") == 0) {
+            captureLoop = 1;
+        } else if (strcmp(argv[a], "-batch") == 0 && a + 1 < argc) {
+            batchPath = argv[++a];
+        } else if (strcmp(argv[a], "-jobs") == 0 && a + 1 < argc) {
+            batchJobs = atoi(argv[++a]);
+        } else if (strcmp(argv[a], "-results") == 0 && a + 1 < argc) {
+            batchOut = argv[++a];
+        } else if (strcmp(argv[a], "-frame") == 0 && a + 1 < argc) {
+            frameN = atoi(argv[++a]);
+        } else if (strcmp(argv[a], "-hop") == 0 && a + 1 < argc) {
+            frameHop = atoi(argv[++a]);
+        } else if (strcmp(argv[a], "-period") == 0 && a + 1 < argc) {
+            capturePeriod = atoi(argv[++a]);
+        } else if (strcmp(argv[a], "-shm") == 0 && a + 1 < argc) {
+            shmName = argv[++a];
+        } else if (strcmp(argv[a], "-noshm") == 0) {
+            shmName = NULL;
+        } else {
+            usage();
+            return 1;
+        }
+    }
+    if ((captureFast || captureLoop) && captureSpec == NULL) {
+        usage();
         return 1;
     }
-
-    // Thread 2: Preprocessing (LP Filter)
-    pthread_attr_init(&attr2);
-    pthread_attr_setinheritsched(&attr2, PTHREAD_EXPLICIT_SCHED);
-    pthread_attr_setschedpolicy(&attr2, SCHED_FIFO);
-    parm2.sched_priority = priorities[1];
-    pthread_attr_setschedparam(&attr2, &parm2);
-    err = pthread_create(&thread2, &attr2, Preprocessing_thread, &parm2);
-    if (err != 0) {
-        fprintf(stderr, "Error creating Preprocessing thread\n");
+    if (frameHop == 0) frameHop = frameN;
+    if (frameN < FRAME_MIN_SAMPLES || frameN > BUF_SIZE || (frameN & (frameN - 1)) != 0
+        || frameHop < 1 || frameHop > frameN
+        || capturePeriod < 1 || capturePeriod > CAPTURE_MAX_BLOCK
+        || (uint32_t)(frameN + capturePeriod) > CAPTURE_RING_SAMPLES / 2) {
+        fprintf(stderr, "Invalid frame %d (power of 2, %d .. %d), hop %d (1 .. frame) or period %d (1 .. %d)\n",
+                frameN, FRAME_MIN_SAMPLES, BUF_SIZE, frameHop, capturePeriod, CAPTURE_MAX_BLOCK);
         return 1;
     }
+    setBlockRate();
 
-    // Thread 3: Speed
-    pthread_attr_init(&attr3);
-    pthread_attr_setinheritsched(&attr3, PTHREAD_EXPLICIT_SCHED);
-    pthread_attr_setschedpolicy(&attr3, SCHED_FIFO);
-    parm3.sched_priority = priorities[2];
-    pthread_attr_setschedparam(&attr3, &parm3);
-    err = pthread_create(&thread3, &attr3, Speed_thread, &parm3); 
-    if (err != 0) {
-        printf("\n\r Error creating Thread [%s]", strerror(err));
-        return 1;
+    // Offline analysis of a recording: worker threads, no real-time
+    // task, no memory locking (the recording is mapped)
+    if (batchPath != NULL) {
+        return runBatch(batchPath, batchOut, batchJobs);
     }
 
-    // Thread 4: Issue
-    pthread_attr_init(&attr4);
-    pthread_attr_setinheritsched(&attr4, PTHREAD_EXPLICIT_SCHED);
-    pthread_attr_setschedpolicy(&attr4, SCHED_FIFO);
-    parm4.sched_priority = priorities[3];
-    pthread_attr_setschedparam(&attr4, &parm4);
-    err = pthread_create(&thread4, &attr4, Issue_thread, &parm4); 
+    // Page-fault-free jobs: all memory locked, small (touched) thread
+    // stacks, task states in a pre-touched arena (see rt/rtmem.h)
+    int err = rtMemLock(RTTASK_STACK_KB * 1024);
     if (err != 0) {
-        printf("\n\r Error creating Thread 4 (Issue) [%s]", strerror(err));
+        fprintf(stderr, "mlockall failed [%s]: page faults possible in the tasks\n", strerror(err));
+    }
+    if (rtArenaInit(&rtArenaMain, RT_ARENA_KB * 1024) != 0) {
+        fprintf(stderr, "Cannot allocate the task arena (%d KB)\n", RT_ARENA_KB);
         return 1;
     }
 
-    // Thread 5: Direction
-    pthread_attr_init(&attr5);
-    pthread_attr_setinheritsched(&attr5, PTHREAD_EXPLICIT_SCHED);
-    pthread_attr_setschedpolicy(&attr5, SCHED_FIFO);
-    parm5.sched_priority = priorities[4];
-    pthread_attr_setschedparam(&attr5, &parm5);
-    err = pthread_create(&thread5, &attr5, Direction_thread, &parm5); 
-    if (err != 0) {
-        printf("\n\r Error creating Thread 5 (Direction) [%s]", strerror(err));
+    // SIGINT/SIGTERM are taken by main with sigwait (no asynchronous
+    // handler): blocked before any thread exists, so all of them inherit
+    // the mask and the signal is left pending for main
+    sigset_t stopSignals;
+    sigemptyset(&stopSignals);
+    sigaddset(&stopSignals, SIGINT);
+    sigaddset(&stopSignals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stopSignals, NULL);
+
+    // Timing statistics appended to STATS_FILE on SIGUSR1. Blocks SIGUSR1,
+    // so it must precede SDL_Init and the threads (they inherit the mask)
+    if (statsDumpOnSignal(SIGUSR1, STATS_FILE) != 0) {
+        fprintf(stderr, "Cannot start the statistics dump thread\n");
+    }
+
+    // Headless: no SDL at all, blocks come from the capture thread
+    if (captureSpec != NULL) {
+        if (captureOpen(&headless, captureSpec, SAMP_FREQ) != 0) {
+            return 1;
+        }
+        printf("Capture: %s, %s\n", headless.desc, captureFast ? "fast" : "real time");
+        captureAck = &rtTasks[PACING_TASK].done;
+        gBytesPerSample = sizeof(uint16_t);
+        gBufferByteSize = RECORDING_BUFFER_SECONDS * SAMP_FREQ * gBytesPerSample;
+        gBufferByteMaxPosition = MAX_RECORDING_SECONDS * SAMP_FREQ * gBytesPerSample;
+        atexit(cleanup);
+    } else {
+        if (SDL_Init(SDL_INIT_AUDIO) < 0) {
+            fprintf(stderr, "SDL could not initialize! SDL Error: %s\n", SDL_GetError());
+            return 1;
+        }
+        atexit(cleanup);
+        if (select_sdl_device(&stopSignals) != 0) {
+            return 1;
+        }
+    }
+
+    // Allocate recording buffer
+    gRecordingBuffer = (uint8_t *)malloc(gBufferByteSize);
+    memset(gRecordingBuffer, 0, gBufferByteSize);
+
+    // Capture periods, cut in frames by the Assembler task (allocated
+    // after mlockall: locked and touched)
+    if (ringInit(&captureRing, CAPTURE_RING_SAMPLES) != 0) {
+        fprintf(stderr, "Cannot allocate the capture ring (%d samples)\n", CAPTURE_RING_SAMPLES);
         return 1;
     }
+    printf("Capture period %d samples, frame %d samples every %d (%.1f ms)\n",
+           capturePeriod, frameN, frameHop, 1000.0 * frameHop / SAMP_FREQ);
+
+    // Empty RTDB: no result yet. Placed in shared memory for the
+    // monitors (rtdbcat, rtdb/shm.h), private if that fails. A name
+    // taken by a running rtsounds is not: -shm or -noshm must be chosen
+    rtdbInit(rtdbMain);
+    if (shmName != NULL) {
+        rtdbExport = rtdbShmCreate(shmName, SAMP_FREQ, frameN);
+        if (rtdbExport != NULL) {
+            rtdbMain = &rtdbExport->db;
+            printf("RTDB exported: shared memory %s (%zu bytes)\n", shmName, sizeof(rtdbShm));
+        } else if (errno == EBUSY) {
+            return 1;
+        }
+    }
 
-    // Thread 6: Display
-    pthread_attr_init(&attr6);
-    pthread_attr_setinheritsched(&attr6, PTHREAD_EXPLICIT_SCHED);
-    pthread_attr_setschedpolicy(&attr6, SCHED_FIFO);
-    parm6.sched_priority = priorities[5];
-    pthread_attr_setschedparam(&attr6, &parm6);
-    err = pthread_create(&thread6, &attr6, Display_thread, &parm6);
-    if (err != 0) {
-        printf("\n\r Error creating Thread 6 (Display) [%s]", strerror(err));
+    // Initialize CAB buffer
+    init_cab(&cab_buffer);
+    init_cab(&filt_cab);
+    printf("CAB Buffer Initialization:\n");
+    for (int i = 0; i < NTASKS + 1; i++) {
+        printf("Buffer %d: nusers=%u\n", i, atomic_load(&cab_buffer.ctrl.nusers[i]));
+    }
+
+    // Select the SIMD kernels for this CPU
+    printf("DSP kernels: %s, FFT: %s precision\n", kernelsIsaName(kernelsInit()),
+           sizeof(specReal) == sizeof(float) ? "single" : "double");
+
+    // Initialize the shared spectrum buffer
+    init_spectrumBuffer(&spec_buffer, frameN, SAMP_FREQ);
+
+    // Overlapped STFT frames for the Speed thread (same frame size as the blocks)
+    if (SPEED_STFT_HOP > 0
+        && stftInit(&speed_stft, frameN, speedStftHop(frameN), SPEED_STFT_RING) != 0) {
+        fprintf(stderr, "Cannot initialize the Speed STFT (hop %d)\n", speedStftHop(frameN));
         return 1;
     }
 
-    // Thread 7: FFT
-    pthread_attr_init(&attr7);
-    pthread_attr_setinheritsched(&attr7, PTHREAD_EXPLICIT_SCHED);
-    pthread_attr_setschedpolicy(&attr7, SCHED_FIFO);
-    parm7.sched_priority = priorities[6];
-    pthread_attr_setschedparam(&attr7, &parm7);
-    err = pthread_create(&thread7, &attr7, FFT_thread, &parm7);
-    if (err != 0) {
-        printf("\n\r Error creating Thread 7 (FFT) [%s]", strerror(err));
+    // Gantt data: binary trace, drained in the background (trace2csv.py converts it)
+    if (traceStart(TRACE_FILE, TRACE_DRAIN_MS) != 0) {
+        perror("Failed to open " TRACE_FILE " for writing");
+    }
+
+    // Clear Status Log
+    FILE *status_logf = fopen(STATUS_LOG_FILE, "w");
+    if (status_logf) {
+        fprintf(status_logf, "RTSounds Log Initialized.\n\n");
+        fclose(status_logf);
+    } else {
+        perror("Failed to open " STATUS_LOG_FILE " for writing");
+    }
+    // Status panels, top to bottom (printed by renderStart's writer)
+    displayPanel = renderRegister();
+    fftPanel = renderRegister();
+
+    // Capture-to-decision latency of each result (printed with the task timing)
+    outSpeed = statsRegisterOutput("speed");
+    outIssue = statsRegisterOutput("issue");
+    outDirection = statsRegisterOutput("direction");
+
+    // One SCHED_FIFO thread per entry of rtTasks
+    clock_gettime(CLOCK_MONOTONIC, &runStart);
+    if (rtTaskStart(rtTasks, NRTTASKS, THREAD_INIT_OFFSET, &rtArenaMain) != 0) {
         return 1;
     }
+    rtTaskReport(stdout, rtTasks, NRTTASKS);
+    rtMemReport(stdout, &rtArenaMain);
 
-    while(1); // Main loop
+    // Status frames: redrawn in place on a terminal and appended to the
+    // log by a background writer, so the tasks never wait for the I/O
+    if (renderStart(STATUS_LOG_FILE, RENDER_WRITE_MS) != 0) {
+        perror("Failed to open " STATUS_LOG_FILE " for appending");
+    }
 
-    return 0;
+    // Main loop: sleeps until SIGINT/SIGTERM, the tasks do all the work
+    int sig;
+    while (sigwait(&stopSignals, &sig) != 0);
+    printf("\nSignal %d: stopping\n", sig);
+
+    return 0;  // cleanup() at exit
 }
 
 /* ***********************************************
 * Auxiliary Functions
 * ************************************************/
+/* ***********************************************
+* CAB operations (see rt/cab.h): never block nor sleep, so they
+* can be used from the SDL audio callback and from any RT thread
+* ***********************************************/
 buffer* cab_getWriteBuffer(cab* c) {
-    for (int i = 0; i < NTASKS + 1; i++) {
-        if (c->buflist[i].nusers == 0) {
-            pthread_mutex_lock(&c->buflist[i].bufMutex);
-            return &c->buflist[i];
-        }
-    }
-    return NULL;  // Return NULL if no available buffer is found
+    int i = cabCtrl_getWriteSlot(&c->ctrl);
+    return (i < 0) ? NULL : &c->buflist[i];  // NULL if no available buffer is found
 }
 
-buffer* cab_getReadBuffer(cab* c) {
-    while (pthread_mutex_trylock(&c->buflist[c->last_write].bufMutex) != 0) {
-        SDL_Delay(10);  
-    }
-    c->buflist[c->last_write].nusers += 1;
-    pthread_mutex_unlock(&c->buflist[c->last_write].bufMutex);
-    return &c->buflist[c->last_write];
+const buffer* cab_getReadBuffer(cab* c) {
+    return &c->buflist[cabCtrl_getReadSlot(&c->ctrl)];
 }
 
+// The writer fills in seq before releasing the buffer. The subscribed
+// tasks are woken once the block is readable.
 void cab_releaseWriteBuffer(cab* c, uint8_t index) {
-    pthread_mutex_unlock(&c->buflist[index].bufMutex);
-    c->last_write = index;
+    cabCtrl_publish(&c->ctrl, index);
+    notifyPublish(&c->notify);
 }
 
 void cab_releaseReadBuffer(cab* c, uint8_t index) {
-    c->buflist[index].nusers--;
-    pthread_mutex_unlock(&c->buflist[index].bufMutex);
+    cabCtrl_release(&c->ctrl, index);
 }
 
 void init_cab(cab *cab_obj) {
-    cab_obj->last_write = 0;
+    cabCtrl_init(&cab_obj->ctrl, NTASKS + 1);
+    notifyInit(&cab_obj->notify);
+    cab_obj->nblocks = 0;
+    cab_obj->captured = 0;
+    cab_obj->samples = 0;
     for (int i = 0; i < NTASKS + 1; i++) {
         memset(cab_obj->buflist[i].buf, 0, sizeof(cab_obj->buflist[i].buf));
-        cab_obj->buflist[i].nusers = 0;
         cab_obj->buflist[i].index = i;
-        pthread_mutex_init(&cab_obj->buflist[i].bufMutex, NULL);
+        cab_obj->buflist[i].seq = 0;
+        cab_obj->buflist[i].sample = 0;
     }
 }
 
+/* ***********************************************
+* Spectrum buffer: same CAB scheme, one writer (spectrum stage),
+* readers access the most recent spectrum in place.
+* ***********************************************/
+spectrum* spec_getWriteBuffer(spectrumBuffer* s) {
+    int i = cabCtrl_getWriteSlot(&s->ctrl);
+    return (i < 0) ? NULL : &s->speclist[i];  // NULL if no available buffer is found
+}
+
+const spectrum* spec_getReadBuffer(spectrumBuffer* s) {
+    return &s->speclist[cabCtrl_getReadSlot(&s->ctrl)];
+}
+
+void spec_releaseWriteBuffer(spectrumBuffer* s, uint8_t index) {
+    cabCtrl_publish(&s->ctrl, index);
+    notifyPublish(&s->notify);
+}
+
+void spec_releaseReadBuffer(spectrumBuffer* s, uint8_t index) {
+    cabCtrl_release(&s->ctrl, index);
+}
+
+void init_spectrumBuffer(spectrumBuffer *s, int N, int fs) {
+    cabCtrl_init(&s->ctrl, NTASKS + 1);
+    notifyInit(&s->notify);
+    for (int i = 0; i < NTASKS + 1; i++) {
+        memset(s->speclist[i].Ak, 0, sizeof(s->speclist[i].Ak));
+        s->speclist[i].version = 0;
+        s->speclist[i].index = i;
+    }
+    for (int k = 0; k <= N/2; k++) {
+        s->fk[k] = (float)k*fs/N;  // Same bins as fftGetAmplitude
+    }
+}
+
+// Appends each capture period, whatever its size, to captureRing: the
+// Assembler task cuts the analysis frames from it
 void audioRecordingCallback(void* userdata, Uint8* stream, int len) {
+    static int traceId = -1;  // Always called from the same SDL audio thread
+    static uint32_t periods = 0;
+    if (traceId < 0) {
+        // First call: the SDL capture thread gets the priority and CPU of
+        // the Audio task (rtTasks[0], -prio p1 / -cpu c1)
+        int err = rtPlaceThread(rtTasks[0].prio, rtTasks[0].cpu);
+        if (err != 0) fprintf(stderr, "SDL capture thread: cannot set priority/CPU [%s]\n", strerror(err));
+        rtPrintPlacement(stdout, captureSpec != NULL ? "Capture feeder" : "SDL capture", pthread_self());
+        traceId = traceRegister("AudioCallback", rtTasks[0].prio);
+    }
+
     // --- GANTT: CAPTURE START TIME ---
     struct timespec start_time, end_time;
     clock_gettime(CLOCK_MONOTONIC, &start_time);
     // --- END GANTT ---
 
-    buffer* writeBuffer = cab_getWriteBuffer(&cab_buffer);
-    
-    if (writeBuffer != NULL && len == BUF_SIZE * sizeof(uint16_t)) {
-        memcpy(writeBuffer->buf, stream, len);
-        cab_releaseWriteBuffer(&cab_buffer, writeBuffer->index);
-        sem_post(&data_ready);
-    }
-    
+    // Samples that do not fit (Assembler late by a whole ring) are
+    // counted in captureRing.dropped
+    ringWrite(&captureRing, (const uint16_t *)stream, len / sizeof(uint16_t), &start_time);  // Releases the Assembler task
+
     // --- GANTT: CAPTURE END TIME & LOG ---
     clock_gettime(CLOCK_MONOTONIC, &end_time);
-    pthread_mutex_lock(&ganttLogMutex); // Use GANTT mutex
-    gantt_logf = fopen("gantt_log.csv", "a"); // Log to CSV
-    if (gantt_logf) {
-        fprintf(gantt_logf, "GANTT,AudioCallback,%d,%ld,%ld,%ld,%ld\n", 
-                99, start_time.tv_sec, start_time.tv_nsec, 
-                end_time.tv_sec, end_time.tv_nsec);
-        fclose(gantt_logf);
-    }
-    pthread_mutex_unlock(&ganttLogMutex);
+    traceEvent(traceId, &start_time, &end_time, ++periods);
     // --- END GANTT ---
 }
 
 
-void filterLP(uint32_t cof, uint32_t sampleFreq, uint8_t *buffer, uint32_t nSamples) {
-    uint16_t *procBuffer = malloc(nSamples * sizeof(uint16_t));
-    uint16_t *origBuffer = (uint16_t *)buffer;
+/* ***********************************************
+ * First-order LP filter
+ * Reads nSamples from in and writes the filtered samples to out
+ * (caller-owned; may be the same array as in). No allocation, and
+ * the CAB slots are never modified: readers get const views.
+ * ***********************************************/
+void filterLP(uint32_t cof, uint32_t sampleFreq, const uint16_t *in, uint16_t *out, uint32_t nSamples) {
     float alfa = (2 * M_PI / sampleFreq * cof) / ((2 * M_PI / sampleFreq * cof) + 1);
     float beta = 1 - alfa;
 
-    procBuffer[0] = origBuffer[0];
+    out[0] = in[0];
     for (int i = 1; i < nSamples; i++) {
-        procBuffer[i] = alfa * origBuffer[i] + beta * procBuffer[i - 1];
+        out[i] = alfa * in[i] + beta * out[i - 1];
     }
+}
 
-    memcpy(buffer, (uint8_t *)procBuffer, nSamples * sizeof(uint16_t));
-    free(procBuffer);
+/* ***********************************************
+ * Magnitude response of filterLP at a given frequency:
+ * |H| = alfa / |1 - beta*exp(-jw)|, w = 2*pi*freq/sampleFreq
+ * ***********************************************/
+float filterLPGain(uint32_t cof, uint32_t sampleFreq, float freq) {
+    float alfa = (2 * M_PI / sampleFreq * cof) / ((2 * M_PI / sampleFreq * cof) + 1);
+    float beta = 1 - alfa;
+    double w = 2 * M_PI * freq / sampleFreq;
+    return alfa / sqrt(1 - 2 * beta * cos(w) + beta * beta);
 }
 
-void save_audio_to_wav(const char* filename, Uint8* buffer, Uint32 buffer_size, int sample_rate) {
+void save_audio_to_wav(const char* filename, const Uint8* buffer, Uint32 buffer_size, int sample_rate) {
     FILE* file = fopen(filename, "wb");
     if (!file) {
         printf("Error opening file for writing\n");
@@ -986,14 +1416,14 @@ void dumpCapturedBufferToWav(const char *filename) {
                 (int)gReceivedRecordingSpec.format, gReceivedRecordingSpec.channels);
     }
 
-    buffer* readBuffer = cab_getReadBuffer(&cab_buffer);
+    const buffer* readBuffer = cab_getReadBuffer(&cab_buffer);
     if (!readBuffer) {
         fprintf(stderr, "dumpCapturedBufferToWav: no buffer available\n");
         return;
     }
 
-    size_t bytes = ABUFSIZE_SAMPLES * sizeof(uint16_t);
-    save_audio_to_wav(filename, (Uint8*)readBuffer->buf, (Uint32)bytes, gReceivedRecordingSpec.freq);
+    size_t bytes = frameN * sizeof(uint16_t);
+    save_audio_to_wav(filename, (const Uint8*)readBuffer->buf, (Uint32)bytes, gReceivedRecordingSpec.freq);
 
     cab_releaseReadBuffer(&cab_buffer, readBuffer->index);
     fprintf(stderr, "WAV dump written: %s (fs=%d, bytes=%zu)\n", filename, gReceivedRecordingSpec.freq, bytes);
@@ -7,15 +7,32 @@
 #define NS_IN_SEC 1000000000L
 #define DEFAULT_PRIO 50            // Default (fixed) thread priority  
 #define BUF_SIZE 4096
-#define NTASKS 7
+#define SPEC_BINS (BUF_SIZE/2 + 1)     /* Spectrum bins, DC .. fs/2 */
+#define NTASKS 8
 #define THREAD_INIT_OFFSET 1000000 // Initial offset (i.e. delay) of rt thread
 #define MONO 1                     /* Sample and play in mono (1 channel) */
 #define SAMP_FREQ 44100            /* Sampling frequency used by audio device */
 #define FORMAT AUDIO_U16           /* Format of each sample (signed, unsigned, 8,16 bits, int/float, ...) */
-#define ABUFSIZE_SAMPLES 4096      /* Audio buffer size in sample FRAMES (total samples divided by channel count) */
+#define ABUFSIZE_SAMPLES 4096      /* Analysis frame in sample FRAMES (total samples divided by channel count), default of -frame */
+#define FRAME_MIN_SAMPLES 256      /* Smallest analysis frame (-frame), the largest is BUF_SIZE */
+#define CAPTURE_PERIOD_SAMPLES 256 /* Capture callback period in sample FRAMES, default of -period */
+#define CAPTURE_RING_SAMPLES 32768 /* Capture ring the frames are cut from (power of 2, see rt/ring.h) */
 #define COF 1000
+#define SPEED_STFT_HOP 1024        /* Speed: STFT hop in samples (N/4: 75% overlap), 0: latest block only */
+#define SPEED_STFT_RING 32768      /* Speed: STFT ring (power of 2, > N + samples of one Speed period) */
 #define MAX_RECORDING_SECONDS 10   /* Maximum recording duration */
 #define RECORDING_BUFFER_SECONDS (MAX_RECORDING_SECONDS + 1) /* Buffer size with padding */
+#define TRACE_FILE "rtsounds_trace.bin" /* Gantt trace (python3 trace2csv.py -> gantt_log.csv) */
+#define TRACE_DRAIN_MS 100         /* Period of the trace drainer thread */
+#define STATUS_LOG_FILE "rtsounds_log.txt" /* Display and FFT reports, appended by the render writer */
+#define RENDER_WRITE_MS 50         /* Period of the render writer thread (rt/render.h) */
+#define STATS_FILE "rtsounds_stats.txt" /* Timing statistics, appended on SIGUSR1 */
+#define PREPROC_DEADLINE_MS 150    /* Relative deadline of the Preprocessing thread */
+#define BLOCK_PERIOD_MS ((int)(1000L * ABUFSIZE_SAMPLES / SAMP_FREQ)) /* Period of one block at the default frame and hop */
+#define FFT_EVERY_BLOCKS 22        /* FFT task: one spectral report per 22 default blocks (~2 s) */
+#define RT_ARENA_KB 512            /* Arena of the task states (rt/rtmem.h) */
+#define DIRECTION_PERIOD_MS 500    /* Direction: period, speed compared with the one of the previous job */
+#define BATCH_FILE "rtsounds_batch.bin" /* -batch results (python3 batch2csv.py -> CSV) */
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -31,60 +48,112 @@
 #include <sys/mman.h>
 #include <math.h>
 #include "fft/fft.h"
+#include "rt/cab.h"
+#include "rt/notify.h"
+#include "rt/ring.h"
+#include "rt/trace.h"
+#include "rt/stats.h"
+#include "rt/rtmem.h"
+#include "rt/rttask.h"
+#include "rt/render.h"
+#include "capture/capture.h"
+#include "batch/batch.h"
+#include "rtdb/rtdb.h"
+#include "rtdb/shm.h"
+#include "dsp/iir.h"
+#include "dsp/kernels.h"
+#include "dsp/stft.h"
+#include "dsp/peak.h"
 #include <SDL.h>
 #include <complex.h>
 #include <SDL_stdinc.h>
 
+/* FFT precision of the spectrum stage (make FFT_FLOAT=1: single precision) */
+#ifdef FFT_FLOAT
+typedef float specReal;
+typedef complex float specComplex;
+typedef fftRealPlanF specFftPlan;
+#define specFftPlanCreate    fftRealPlanCreateF
+#define specFftPlanDestroy   fftRealPlanDestroyF
+#define specFftExecutePacked fftExecuteRealPackedF
+#define specConvertCenterU16 kConvertCenterU16F
+#define specAmplitude        kAmplitudeF
+#else
+typedef double specReal;
+typedef complex double specComplex;
+typedef fftRealPlan specFftPlan;
+#define specFftPlanCreate    fftRealPlanCreate
+#define specFftPlanDestroy   fftRealPlanDestroy
+#define specFftExecutePacked fftExecuteRealPacked
+#define specConvertCenterU16 kConvertCenterU16
+#define specAmplitude        kAmplitude
+#endif
+
 typedef struct {
     uint16_t buf[BUF_SIZE];
-    uint8_t nusers;
     uint8_t index;
-    pthread_mutex_t bufMutex;
+    uint32_t seq;             // number of the assembled frame (1, 2, ...); a gap: blocks lost
+    struct timespec ready;    // when the callback got its last sample (CLOCK_MONOTONIC, at its entry)
+    uint64_t sample;          // offset of its first sample in the captured stream
 } buffer;
 
+// NTASKS+1 slots: at most NTASKS-1 readers + last_write + the one being written
 typedef struct {
     buffer buflist[NTASKS+1];
-    uint8_t last_write;
+    cabCtrl ctrl;             // last_write and nusers (atomic)
+    rtNotify notify;          // published with each block (wakes the subscribed tasks)
+    uint32_t nblocks;         // blocks published so far (maintained by the writer)
+    uint32_t captured;        // frames assembled, published or not (capture CAB)
+    uint64_t samples;         // samples captured so far (capture CAB)
 } cab;
 
-
+// Amplitude spectrum of one captured block (computed once, read by many)
 typedef struct {
-    float maxIssueAmplitude;  // maximum amplitude of frequencies below 200Hz
-    float ratio;              // ratio to the max amplitude at other ranges
-} issueVars;
+    float Ak[SPEC_BINS];      // amplitude of each bin
+    uint32_t version;         // seq of the source CAB block (0: none yet)
+    struct timespec ready;    // capture of the source block
+    uint64_t sample;          // first sample of the source block
+    uint32_t stftHead;        // Speed STFT stream written up to the end of the source block
+    uint32_t stftRestart;     // Speed STFT stream position where the audio last resumed after a gap
+    uint8_t index;
+} spectrum;
 
-// Estruturas globais necessárias
+// CAB with the most recent spectrum (readers use it in place)
 typedef struct {
-    float forwards;
-    float lastAmplitude;
-    float lastFrequency;
-} DirectionValues;
+    spectrum speclist[NTASKS+1];
+    cabCtrl ctrl;
+    rtNotify notify;          // published with each spectrum
+    float fk[SPEC_BINS];      // frequency of each bin (constant)
+} spectrumBuffer;
+
 
 typedef struct {
-    float detectedSpeed;
-} SpeedValues;
+    float maxIssueAmplitude;  // maximum amplitude of frequencies below 200Hz
+    float ratio;              // ratio to the max amplitude at other ranges
+} issueVars;
 
-DirectionValues directionValues = {0.0, 0.0, 0.0};
-SpeedValues speedValues = {0.0};
 struct  timespec TsAdd(struct  timespec  ts1, struct  timespec  ts2);
 struct  timespec TsSub(struct  timespec  ts1, struct  timespec  ts2);
 
-
-// Variáveis para a Issue Thread (Prio 60)
-volatile float detectedIssueFrequency = 0.0;
-volatile float issueRatio = 0.0;
-volatile int issueDetected = 0;
-
-// Variáveis para a Direction Thread (Prio 50)
-volatile int directionValue = 0; // 1: Forward, -1: Reverse, 0: Stop/Unknown
+// Latest result of the Speed, Issue and Direction tasks (rtdb/rtdb.h):
+// each task writes its own record, any task reads them without a lock.
+// In the exported segment (rtdb/shm.h) if it could be created
+rtdb rtdbLocal;
+rtdb *rtdbMain = &rtdbLocal;
 buffer* cab_getWriteBuffer(cab* c);
-buffer* cab_getReadBuffer(cab* c);
+const buffer* cab_getReadBuffer(cab* c);
 void cab_releaseWriteBuffer(cab* c, uint8_t index);
 void cab_releaseReadBuffer(cab* c, uint8_t index);
+spectrum* spec_getWriteBuffer(spectrumBuffer* s);
+const spectrum* spec_getReadBuffer(spectrumBuffer* s);
+void spec_releaseWriteBuffer(spectrumBuffer* s, uint8_t index);
+void spec_releaseReadBuffer(spectrumBuffer* s, uint8_t index);
 void usage();
 void init_cab(cab *cab_obj);
+void init_spectrumBuffer(spectrumBuffer *s, int N, int fs);
 void audioRecordingCallback(void* userdata, Uint8* stream, int len);
-void filterLP(uint32_t cof, uint32_t sampleFreq, uint8_t * buffer, uint32_t nSamples);
+void filterLP(uint32_t cof, uint32_t sampleFreq, const uint16_t *in, uint16_t *out, uint32_t nSamples);
+float filterLPGain(uint32_t cof, uint32_t sampleFreq, float freq);
 float frequency_to_speed(float frequency_hz);
 int detectDirection(float curAmplitude, float lastAmplitude, float curFrequency, float lastFrequency, float speed);
 float relativeDiff(float a, float b);
@@ -0,0 +1,58 @@
+#!/usr/bin/env python3
+# Converts the binary Gantt trace written by rtsounds (rt/trace.h) to the
+# CSV read by gantt_chart.py.
+#
+# Usage: python3 trace2csv.py [trace.bin] [gantt_log.csv] [--extended]
+#   --extended appends the CPU and block number of each job as two more
+#   columns (gantt_chart.py expects the plain format).
+
+import struct
+import sys
+
+NS_IN_SEC = 1_000_000_000
+HEADER = struct.Struct('<8sII')            # magic, version, record size
+TASK = struct.Struct('<IHhi20s')           # type, task, reserved, prio, name
+JOB = struct.Struct('<IHhQQIi')            # type, task, cpu, start, end, block, prio
+REC_TASK, REC_JOB = 1, 2
+
+
+def convert(src, dst, extended):
+    with open(src, 'rb') as f:
+        data = f.read()
+
+    magic, version, size = HEADER.unpack_from(data, 0)
+    if magic.rstrip(b'\0') != b'RTTRACE' or version != 1 or size != JOB.size:
+        sys.exit(f"Error: '{src}' is not a version 1 rtsounds trace")
+
+    names = {}
+    jobs = 0
+    with open(dst, 'w') as out:
+        out.write('# TaskName,Priority,StartSec,StartNsec,EndSec,EndNsec'
+                  + (',CPU,Block' if extended else '') + '\n')
+        for off in range(HEADER.size, len(data) - size + 1, size):
+            rtype = struct.unpack_from('<I', data, off)[0]
+            if rtype == REC_TASK:
+                _, task, _, prio, name = TASK.unpack_from(data, off)
+                names[task] = name.split(b'\0')[0].decode()
+            elif rtype == REC_JOB:
+                _, task, cpu, start, end, block, prio = JOB.unpack_from(data, off)
+                line = 'GANTT,%s,%d,%d,%d,%d,%d' % (
+                    names.get(task, 'task%d' % task), prio,
+                    start // NS_IN_SEC, start % NS_IN_SEC, end // NS_IN_SEC, end % NS_IN_SEC)
+                if extended:
+                    line += ',%d,%d' % (cpu, block)
+                out.write(line + '\n')
+                jobs += 1
+
+    print(f"{jobs} jobs of {len(names)} tasks written to {dst}")
+
+
+def main():
+    args = [a for a in sys.argv[1:] if not a.startswith('--')]
+    src = args[0] if len(args) > 0 else 'rtsounds_trace.bin'
+    dst = args[1] if len(args) > 1 else 'gantt_log.csv'
+    convert(src, dst, '--extended' in sys.argv)
+
+
+if __name__ == '__main__':
+    main()